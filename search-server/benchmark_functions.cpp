@@ -0,0 +1,631 @@
+#include "benchmark_functions.h"
+#include "corpus_import.h"
+#include "log_duration.h"
+#include "query_analytics.h"
+
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+const string& GenerateFrequentWord(mt19937& generator, const vector<string>& dictionary) {
+    const double x = uniform_real_distribution(0.0, 1.0)(generator);
+    return dictionary[static_cast<size_t>(x * x * x * dictionary.size())];
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution(0.0, 1.0)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += GenerateFrequentWord(generator, dictionary);
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, uniform_int_distribution(1, max_word_count)(generator), 0.1));
+    }
+    return queries;
+}
+
+void FillBenchmarkServer(SearchServer& search_server, mt19937& generator, const vector<string>& dictionary,
+                         int document_count, int max_word_count) {
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            if (!text.empty()) {
+                text.push_back(' ');
+            }
+            text += GenerateFrequentWord(generator, dictionary);
+        }
+        const auto status = static_cast<DocumentStatus>(uniform_int_distribution(0, 3)(generator));
+        search_server.AddDocument(document_id, text, status, {uniform_int_distribution(-10, 10)(generator)});
+    }
+}
+
+void GenerateCorpusFile(const string& path, mt19937& generator, const vector<string>& dictionary,
+                        int document_count, int max_word_count) {
+    ofstream out(path);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        const auto status = static_cast<DocumentStatus>(uniform_int_distribution(0, 3)(generator));
+        out << document_id << '\t' << GetStatusName(status) << '\t';
+        const int rating_count = uniform_int_distribution(0, 3)(generator);
+        for (int i = 0; i < rating_count; ++i) {
+            out << (i > 0 ? ","s : ""s) << uniform_int_distribution(-10, 10)(generator);
+        }
+        out << '\t';
+        const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            out << (i > 0 ? " "s : ""s) << GenerateFrequentWord(generator, dictionary);
+        }
+        out << '\n';
+    }
+}
+
+namespace {
+
+template <typename DocumentPredicate>
+void BenchmarkFilter(string_view mark, const SearchServer& search_server, const vector<string>& queries,
+                     DocumentPredicate document_predicate) {
+    size_t found = 0;
+    {
+        LOG_DURATION(mark);
+        for (const string& query : queries) {
+            found += search_server.FindTopDocuments(execution::seq, query, document_predicate).size();
+        }
+    }
+    cerr << "  documents found: "s << found << endl;
+}
+
+}  // namespace
+
+void BenchmarkScoringKernels() {
+    mt19937 generator(7);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    SearchServer search_server(dictionary[0]);
+    FillBenchmarkServer(search_server, generator, dictionary, 100'000, 30);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 3);
+
+    BenchmarkFilter("no filter, kernel"sv, search_server, queries, AnyDocument{});
+    BenchmarkFilter("no filter, generic"sv, search_server, queries, [](int, DocumentStatus, int) {
+        return true;
+    });
+
+    BenchmarkFilter("status, kernel"sv, search_server, queries, DocumentStatus::ACTUAL);
+    BenchmarkFilter("status, generic"sv, search_server, queries, [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    });
+
+    vector<int> allowed_ids;
+    for (int document_id = 0; document_id < 100'000; document_id += 10) {
+        allowed_ids.push_back(document_id);
+    }
+    const DocumentIdSet id_set(allowed_ids);
+    BenchmarkFilter("id set, kernel"sv, search_server, queries, id_set);
+    BenchmarkFilter("id set, generic"sv, search_server, queries, [&allowed_ids](int document_id, DocumentStatus, int) {
+        return binary_search(allowed_ids.begin(), allowed_ids.end(), document_id);
+    });
+
+    BenchmarkFilter("predicate, generic"sv, search_server, queries, [](int document_id, DocumentStatus, int rating) {
+        return document_id % 2 == 0 && rating > 0;
+    });
+}
+
+void BenchmarkPositionalIndex() {
+    mt19937 generator(11);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const int document_count = 50'000;
+
+    SearchServer plain_server(dictionary[0]);
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer positional_server(dictionary[0], options);
+    {
+        mt19937 documents_generator(13);
+        LOG_DURATION("positional index off, AddDocument"sv);
+        FillBenchmarkServer(plain_server, documents_generator, dictionary, document_count, 30);
+    }
+    {
+        mt19937 documents_generator(13);
+        LOG_DURATION("positional index on, AddDocument"sv);
+        FillBenchmarkServer(positional_server, documents_generator, dictionary, document_count, 30);
+    }
+    const size_t memory = positional_server.GetPositionalIndexMemoryUsage();
+    cerr << "positional index memory: "s << memory << " bytes, "s
+         << memory / document_count << " bytes per document"s << endl;
+
+    vector<string> queries;
+    vector<string> phrase_queries;
+    for (int i = 0; i < 500; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 2));
+        phrase_queries.push_back("\""s + queries.back() + "\""s);
+    }
+    BenchmarkFilter("two words, positional index off"sv, plain_server, queries, DocumentStatus::ACTUAL);
+    BenchmarkFilter("two words, positional index on"sv, positional_server, queries, DocumentStatus::ACTUAL);
+    BenchmarkFilter("phrase, positional index on"sv, positional_server, phrase_queries, DocumentStatus::ACTUAL);
+}
+
+void BenchmarkImpactOrderedPostings() {
+    mt19937 generator(17);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const int document_count = 200'000;
+    // слово dfN встречается ровно в N документах, число его повторов в документе случайно
+    const vector<int> document_freqs = {100, 1'000, 10'000, 100'000};
+
+    SearchServer plain_server(dictionary[0]);
+    SearchServerOptions options;
+    options.impact_ordered_postings = true;
+    SearchServer impact_server(dictionary[0], options);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(5, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += GenerateFrequentWord(generator, dictionary);
+            text.push_back(' ');
+        }
+        for (const int document_freq : document_freqs) {
+            if (document_id % (document_count / document_freq) == 0) {
+                const int repeat_count = uniform_int_distribution(1, 4)(generator);
+                for (int i = 0; i < repeat_count; ++i) {
+                    text += "df"s + to_string(document_freq) + " "s;
+                }
+            }
+        }
+        const auto status = static_cast<DocumentStatus>(uniform_int_distribution(0, 3)(generator));
+        const int rating = uniform_int_distribution(-10, 10)(generator);
+        plain_server.AddDocument(document_id, text, status, {rating});
+        impact_server.AddDocument(document_id, text, status, {rating});
+    }
+
+    for (const int document_freq : document_freqs) {
+        const string word = "df"s + to_string(document_freq);
+        const vector<string> single_word(200, word);
+        vector<string> two_words;
+        for (int i = 0; i < 200; ++i) {
+            two_words.push_back(word + " "s + GenerateFrequentWord(generator, dictionary));
+        }
+        cerr << "posting list length "s << document_freq << ":"s << endl;
+        BenchmarkFilter("  one word, impact order off"sv, plain_server, single_word, AnyDocument{});
+        BenchmarkFilter("  one word, impact order on"sv, impact_server, single_word, AnyDocument{});
+        BenchmarkFilter("  two words, impact order off"sv, plain_server, two_words, DocumentStatus::ACTUAL);
+        BenchmarkFilter("  two words, impact order on"sv, impact_server, two_words, DocumentStatus::ACTUAL);
+    }
+}
+
+void BenchmarkBitmapPostings() {
+    mt19937 generator(31);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const int document_count = 300'000;
+
+    SearchServerOptions options;
+    options.bitmap_postings_min_documents = 0;
+    SearchServer plain_server(dictionary[0], options);
+    SearchServer bitmap_server(dictionary[0]);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(5, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += GenerateFrequentWord(generator, dictionary);
+            text.push_back(' ');
+        }
+        // заблокированных документов мало: фильтр по статусу отсекает почти весь список
+        const auto status = uniform_int_distribution(0, 99)(generator) < 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        plain_server.AddDocument(document_id, text, status, {1});
+        bitmap_server.AddDocument(document_id, text, status, {1});
+    }
+    cerr << "postings memory, bitmaps off: "s << plain_server.GetPostingsMemoryUsage() / 1024 << " KiB, on: "s
+         << bitmap_server.GetPostingsMemoryUsage() / 1024 << " KiB"s << endl;
+
+    vector<string> frequent_words;
+    vector<string> many_minus_words;
+    for (int i = 0; i < 200; ++i) {
+        frequent_words.push_back(dictionary[i % 10 + 1] + " "s + dictionary[i % 7 + 20]);
+        string query = dictionary[i % 50 + 1];
+        for (int j = 0; j < 4; ++j) {
+            query += " -"s + dictionary[(i + j) % 10 + 60];
+        }
+        many_minus_words.push_back(query);
+    }
+    BenchmarkFilter("frequent words, BANNED, bitmaps off"sv, plain_server, frequent_words, DocumentStatus::BANNED);
+    BenchmarkFilter("frequent words, BANNED, bitmaps on"sv, bitmap_server, frequent_words, DocumentStatus::BANNED);
+    BenchmarkFilter("frequent words, ACTUAL, bitmaps off"sv, plain_server, frequent_words, DocumentStatus::ACTUAL);
+    BenchmarkFilter("frequent words, ACTUAL, bitmaps on"sv, bitmap_server, frequent_words, DocumentStatus::ACTUAL);
+    BenchmarkFilter("four minus words, bitmaps off"sv, plain_server, many_minus_words, DocumentStatus::ACTUAL);
+    BenchmarkFilter("four minus words, bitmaps on"sv, bitmap_server, many_minus_words, DocumentStatus::ACTUAL);
+}
+
+// Однословные запросы с частыми словами вперемешку с добавлением и удалением документов
+void BenchmarkHotTerms() {
+    mt19937 generator(37);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const int document_count = 100'000;
+    const int update_count = 500;
+
+    SearchServerOptions options;
+    options.hot_terms = 256;
+    SearchServer plain_server(dictionary[0]);
+    SearchServer hot_terms_server(dictionary[0], options);
+    vector<string> texts;
+    for (int document_id = 0; document_id < document_count + update_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(5, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += GenerateFrequentWord(generator, dictionary);
+            text.push_back(' ');
+        }
+        texts.push_back(move(text));
+    }
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        const vector<int> ratings{document_id % 11};
+        plain_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, ratings);
+        hot_terms_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, ratings);
+    }
+
+    vector<string> queries;
+    for (int i = 0; i < 5'000; ++i) {
+        queries.push_back(GenerateFrequentWord(generator, dictionary));
+    }
+    const auto run = [&](string_view mark, SearchServer& search_server) {
+        size_t found = 0;
+        LOG_DURATION(mark);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            // каждые 10 запросов один документ добавляется и один удаляется
+            if (i % 10 == 0) {
+                const int update = static_cast<int>(i / 10);
+                search_server.AddDocument(document_count + update, texts[document_count + update], DocumentStatus::ACTUAL, {update % 11});
+                search_server.RemoveDocument(update * 97 % document_count);
+            }
+            found += search_server.FindTopDocuments(execution::seq, queries[i], DocumentStatus::ACTUAL).size();
+        }
+        cerr << "  documents found: "s << found << endl;
+    };
+    run("single-word queries with updates, hot terms off"sv, plain_server);
+    run("single-word queries with updates, hot terms on"sv, hot_terms_server);
+}
+
+// Запросы из редких слов (короткие списки) и из частых (длинные списки) последовательно,
+// параллельно и с выбором планировщика
+void BenchmarkQueryPlanner() {
+    mt19937 generator(41);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    SearchServer search_server(dictionary[0]);
+    FillBenchmarkServer(search_server, generator, dictionary, 100'000, 30);
+    const QueryCostModel& cost_model = search_server.GetCostModel();
+    cerr << "planner threshold: "s
+         << (cost_model.parallel_min_work == NEVER_PARALLEL ? "never"s : to_string(cost_model.parallel_min_work))
+         << " on "s << cost_model.thread_count << " threads"s << endl;
+
+    vector<string> rare_queries;
+    for (int i = 0; i < 10'000; ++i) {
+        string query;
+        for (int j = 0; j < 3; ++j) {
+            query += dictionary[uniform_int_distribution<size_t>(dictionary.size() / 2, dictionary.size() - 1)(generator)];
+            query.push_back(' ');
+        }
+        rare_queries.push_back(move(query));
+    }
+    vector<string> frequent_queries = GenerateQueries(generator, dictionary, 1'000, 3);
+
+    for (const auto& [name, queries] : {pair{"rare words"s, &rare_queries}, pair{"frequent words"s, &frequent_queries}}) {
+        size_t found = 0;
+        {
+            LOG_DURATION(name + ", seq"s);
+            for (const string& query : *queries) {
+                found += search_server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL).size();
+            }
+        }
+        {
+            LOG_DURATION(name + ", par"s);
+            for (const string& query : *queries) {
+                found += search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL).size();
+            }
+        }
+        {
+            LOG_DURATION(name + ", planner"s);
+            for (const string& query : *queries) {
+                found += search_server.FindTopDocuments(query, DocumentStatus::ACTUAL).size();
+            }
+        }
+        cerr << "  documents found: "s << found << endl;
+    }
+}
+
+// Добавление документов без постоянных запросов и со 100 тысячами запросов. Слова запросов
+// выбираются из словаря вдесятеро больше словаря документов: как и имена в запросах
+// оповещений, большинство из них в новых документах не встречается.
+void BenchmarkStandingQueries() {
+    mt19937 generator(43);
+    const auto query_dictionary = GenerateDictionary(generator, 200'000, 10);
+    const vector<string> dictionary(query_dictionary.begin(), query_dictionary.begin() + 20'000);
+    const int document_count = 50'000;
+    vector<string> texts;
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += GenerateFrequentWord(generator, dictionary);
+            text.push_back(' ');
+        }
+        texts.push_back(move(text));
+    }
+
+    const auto run = [&](size_t query_count) {
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < query_count; ++i) {
+            string query;
+            const int word_count = uniform_int_distribution(1, 3)(generator);
+            for (int j = 0; j < word_count; ++j) {
+                if (j > 0 && uniform_int_distribution(0, 4)(generator) == 0) {
+                    query.push_back('-');
+                }
+                query += query_dictionary[uniform_int_distribution<size_t>(1, query_dictionary.size() - 1)(generator)];
+                query.push_back(' ');
+            }
+            search_server.AddStandingQuery(query);
+        }
+        size_t match_count = 0;
+        search_server.SetStandingQueryHandler([&match_count](const StandingQueryMatch&) {
+            ++match_count;
+        });
+        {
+            LOG_DURATION("add documents, "s + to_string(query_count) + " standing queries"s);
+            for (int document_id = 0; document_id < document_count; ++document_id) {
+                search_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {1});
+            }
+        }
+        cerr << "  matches: "s << match_count << endl;
+    };
+    run(0);
+    run(100'000);
+}
+
+void BenchmarkWriteAheadLog() {
+    mt19937 generator(47);
+    const auto dictionary = GenerateDictionary(generator, 20'000, 10);
+    const int document_count = 200'000;
+    vector<string> texts;
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string text;
+        const int word_count = uniform_int_distribution(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += GenerateFrequentWord(generator, dictionary);
+            text.push_back(' ');
+        }
+        texts.push_back(move(text));
+    }
+    const string directory = (filesystem::temp_directory_path() / "search_server_wal"s).string();
+
+    // каждое десятое изменение - удаление; sync_interval - через сколько изменений ждать
+    // записи на диск, как сетевой сервер перед ответами на пакет, 0 - только в конце
+    const auto run = [&](const string& mark, bool use_log, bool sync_to_disk, int sync_interval) {
+        filesystem::remove_all(directory);
+        SearchServer search_server(dictionary[0]);
+        if (use_log) {
+            WriteAheadLogOptions options;
+            options.sync_to_disk = sync_to_disk;
+            search_server.OpenWriteAheadLog(directory, options);
+        }
+        LOG_DURATION(mark);
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            search_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {1, 2, 3});
+            if (document_id % 10 == 9) {
+                search_server.RemoveDocument(document_id - 5);
+            }
+            if (sync_interval > 0 && document_id % sync_interval == sync_interval - 1) {
+                search_server.SyncWriteAheadLog();
+            }
+        }
+        search_server.SyncWriteAheadLog();
+    };
+    run("changes without log"s, false, false, 0);
+    run("changes, log without fdatasync"s, true, false, 0);
+    run("changes, log, fdatasync at the end"s, true, true, 0);
+    run("changes, log, fdatasync every 256 changes"s, true, true, 256);
+    cerr << "  log: "s << filesystem::file_size(directory + "/log"s) << " bytes"s << endl;
+
+    {
+        SearchServer search_server(dictionary[0]);
+        {
+            LOG_DURATION("recovery from log"sv);
+            const WriteAheadLogRecovery recovery = search_server.OpenWriteAheadLog(directory);
+            cerr << "  "s << recovery.log_records << " records, "s << search_server.GetDocumentCount() << " documents"s << endl;
+        }
+        LOG_DURATION("checkpoint"sv);
+        search_server.Checkpoint();
+    }
+    {
+        SearchServer search_server(dictionary[0]);
+        LOG_DURATION("recovery from checkpoint"sv);
+        const WriteAheadLogRecovery recovery = search_server.OpenWriteAheadLog(directory);
+        cerr << "  "s << recovery.checkpoint_records << " records, "s << search_server.GetDocumentCount() << " documents"s << endl;
+    }
+    filesystem::remove_all(directory);
+}
+
+void BenchmarkCorpusImport() {
+    mt19937 generator(19);
+    const auto dictionary = GenerateDictionary(generator, 20'000, 10);
+    const string path = (filesystem::temp_directory_path() / "search_server_corpus.tsv"s).string();
+    const int document_count = 300'000;
+    GenerateCorpusFile(path, generator, dictionary, document_count, 50);
+    cerr << "corpus: "s << document_count << " documents, "s << filesystem::file_size(path) << " bytes"s << endl;
+
+    {
+        SearchServer search_server(dictionary[0]);
+        LOG_DURATION("getline + AddDocument"sv);
+        ifstream in(path);
+        vector<int> ratings;
+        for (string line; getline(in, line);) {
+            PreparedDocument document = ParseCorpusRecord(search_server, line, ratings);
+            search_server.AddDocument(document.id, document.text, document.status, ratings);
+        }
+    }
+    {
+        SearchServer search_server(dictionary[0]);
+        LOG_DURATION("ImportCorpus"sv);
+        CorpusImportOptions options;
+        options.progress = [](const CorpusImportProgress& progress) {
+            cerr << "  "s << progress.document_count << " documents, "s
+                 << progress.processed_bytes * 100 / max<size_t>(progress.total_bytes, 1) << "%, "s
+                 << static_cast<size_t>(progress.GetDocumentsPerSecond()) << " docs/sec"s << endl;
+        };
+        ImportCorpus(search_server, path, options);
+    }
+    remove(path.c_str());
+}
+
+void BenchmarkTermLookups() {
+    mt19937 generator(23);
+    const auto dictionary = GenerateDictionary(generator, 50'000, 10);
+    vector<string_view> tokens;
+    for (int i = 0; i < 2'000'000; ++i) {
+        tokens.push_back(GenerateFrequentWord(generator, dictionary));
+    }
+
+    const set<string, less<>> stop_word_tree(dictionary.begin(), dictionary.begin() + 300);
+    const StopWordSet stop_word_set(stop_word_tree);
+    size_t found = 0;
+    {
+        LOG_DURATION("stop words, set::count"sv);
+        for (const string_view token : tokens) {
+            found += stop_word_tree.count(token);
+        }
+    }
+    {
+        LOG_DURATION("stop words, perfect hash"sv);
+        for (const string_view token : tokens) {
+            found -= stop_word_set.Contains(token);
+        }
+    }
+    cerr << "  mismatches: "s << found << endl;
+
+    // словарь из половины слов, ищутся слова из другой половины
+    const size_t half = dictionary.size() / 2;
+    map<string_view, int> vocabulary;
+    BloomFilter filter(half);
+    for (size_t i = 0; i < half; ++i) {
+        vocabulary.emplace(dictionary[i], static_cast<int>(i));
+        filter.Add(dictionary[i]);
+    }
+    vector<string_view> absent_words(dictionary.begin() + half, dictionary.end());
+    size_t probes = 0;
+    {
+        LOG_DURATION("absent words, map::find"sv);
+        for (int round = 0; round < 40; ++round) {
+            for (const string_view word : absent_words) {
+                probes += vocabulary.find(word) != vocabulary.end();
+            }
+        }
+    }
+    {
+        LOG_DURATION("absent words, bloom filter + map::find"sv);
+        for (int round = 0; round < 40; ++round) {
+            for (const string_view word : absent_words) {
+                probes += filter.MayContain(word) && vocabulary.find(word) != vocabulary.end();
+            }
+        }
+    }
+    cerr << "  false positives: "s << probes << endl;
+}
+
+void BenchmarkQueryAnalytics() {
+    mt19937 generator(29);
+    const auto dictionary = GenerateDictionary(generator, 5'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 10'000, 3);
+    const int record_count = 1'000'000;
+
+    // прежняя схема: очередь результатов и подсчёт пустых обходом окна
+    deque<vector<Document>> requests;
+    uint64_t no_results = 0;
+    {
+        LOG_DURATION("query history, deque + scan"sv);
+        for (int i = 0; i < record_count; ++i) {
+            if (requests.size() == DEFAULT_WINDOW_REQUESTS) {
+                requests.pop_front();
+            }
+            requests.push_back(vector<Document>(i % 3));
+            if (i % 100 == 0) {
+                no_results += count_if(requests.begin(), requests.end(), [](const auto& documents) {
+                    return documents.empty();
+                });
+            }
+        }
+    }
+    QueryAnalytics analytics;
+    {
+        LOG_DURATION("query history, analytics"sv);
+        for (int i = 0; i < record_count; ++i) {
+            analytics.Record(queries[i % queries.size()], i % 3, chrono::microseconds(i % 5000));
+            if (i % 100 == 0) {
+                no_results -= analytics.GetNoResultRequests();
+            }
+        }
+    }
+    cerr << "  mismatches: "s << no_results << endl;
+
+    const size_t thread_count = max(4u, thread::hardware_concurrency());
+    QueryAnalytics shared_analytics;
+    {
+        LOG_DURATION("query history, analytics, "s + to_string(thread_count) + " threads"s);
+        vector<thread> threads;
+        for (size_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; i < static_cast<size_t>(record_count); i += thread_count) {
+                    shared_analytics.Record(queries[i % queries.size()], i % 3, chrono::microseconds(i % 5000));
+                }
+            });
+        }
+        for (auto& worker : threads) {
+            worker.join();
+        }
+    }
+    cerr << "  requests in window: "s << shared_analytics.GetStats().request_count << endl;
+}
+
+void RunBenchmarks() {
+    BenchmarkScoringKernels();
+    BenchmarkPositionalIndex();
+    BenchmarkImpactOrderedPostings();
+    BenchmarkBitmapPostings();
+    BenchmarkHotTerms();
+    BenchmarkQueryPlanner();
+    BenchmarkStandingQueries();
+    BenchmarkWriteAheadLog();
+    BenchmarkCorpusImport();
+    BenchmarkTermLookups();
+    BenchmarkQueryAnalytics();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Синтетические данные для замеров производительности
+string GenerateWord(mt19937& generator, int max_length);
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length);
+// Слова выбираются с убывающей частотой, чтобы у первых слов словаря были длинные списки документов
+const string& GenerateFrequentWord(mt19937& generator, const vector<string>& dictionary);
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0);
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count);
+void FillBenchmarkServer(SearchServer& search_server, mt19937& generator, const vector<string>& dictionary,
+                         int document_count, int max_word_count);
+// Корпус для ImportCorpus: id, статус, рейтинги и текст через табуляцию
+void GenerateCorpusFile(const string& path, mt19937& generator, const vector<string>& dictionary,
+                        int document_count, int max_word_count);
+
+void BenchmarkScoringKernels();
+void BenchmarkPositionalIndex();
+void BenchmarkImpactOrderedPostings();
+void BenchmarkBitmapPostings();
+void BenchmarkHotTerms();
+void BenchmarkQueryPlanner();
+void BenchmarkStandingQueries();
+void BenchmarkWriteAheadLog();
+void BenchmarkCorpusImport();
+void BenchmarkTermLookups();
+void BenchmarkQueryAnalytics();
+
+// Запускает все замеры, вывод - в cerr через LOG_DURATION
+void RunBenchmarks();
@@ -0,0 +1,53 @@
+#include "bloom_filter.h"
+#include "word_hash.h"
+
+using namespace std;
+
+namespace {
+
+const uint64_t BLOOM_SEED = 0xB10F;
+
+}  // namespace
+
+BloomFilter::BloomFilter(size_t capacity)
+    : capacity_(capacity) {
+    size_t block_count = 1;
+    while (block_count * WORDS_PER_BLOCK * 64 < capacity * BITS_PER_ITEM) {
+        block_count *= 2;
+    }
+    block_mask_ = block_count - 1;
+    bits_.assign(block_count * WORDS_PER_BLOCK, 0);
+}
+
+void BloomFilter::Add(string_view word) {
+    if (bits_.empty()) {
+        return;
+    }
+    uint64_t hash = HashWord(word, BLOOM_SEED);
+    uint64_t* block = &bits_[(hash & block_mask_) * WORDS_PER_BLOCK];
+    for (int i = 0; i < PROBE_COUNT; ++i) {
+        hash = hash * 0x9E3779B97F4A7C15ull + 1;
+        const uint64_t bit = hash >> 55;
+        block[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+}
+
+bool BloomFilter::MayContain(string_view word) const {
+    if (bits_.empty()) {
+        return false;
+    }
+    uint64_t hash = HashWord(word, BLOOM_SEED);
+    const uint64_t* block = &bits_[(hash & block_mask_) * WORDS_PER_BLOCK];
+    for (int i = 0; i < PROBE_COUNT; ++i) {
+        hash = hash * 0x9E3779B97F4A7C15ull + 1;
+        const uint64_t bit = hash >> 55;
+        if ((block[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t BloomFilter::GetCapacity() const {
+    return capacity_;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Фильтр Блума с блоками по 64 байта: все биты одного слова лежат в одной
+// кэш-линии. MayContain == false означает, что слово точно не добавлялось;
+// true может оказаться ложным срабатыванием (около 1% при заполнении до capacity).
+class BloomFilter {
+public:
+    BloomFilter() = default;
+    explicit BloomFilter(size_t capacity);
+
+    void Add(std::string_view word);
+    bool MayContain(std::string_view word) const;
+
+    // сколько слов можно добавить без роста доли ложных срабатываний
+    size_t GetCapacity() const;
+
+private:
+    static const size_t WORDS_PER_BLOCK = 8;
+    static const int PROBE_COUNT = 6;
+    static const size_t BITS_PER_ITEM = 10;
+
+    size_t capacity_ = 0;
+    size_t block_mask_ = 0;
+    std::vector<uint64_t> bits_;
+};
@@ -0,0 +1,33 @@
+#include "command_line.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+map<string, string> ParseArguments(int argc, char* argv[]) {
+    map<string, string> arguments;
+    for (int i = 1; i < argc; i += 2) {
+        const string name = argv[i];
+        if (name.substr(0, 2) != "--"s || i + 1 >= argc) {
+            throw invalid_argument("Invalid argument "s + name);
+        }
+        arguments[name.substr(2)] = argv[i + 1];
+    }
+    return arguments;
+}
+
+string GetArgument(map<string, string>& arguments, const string& name, const string& default_value) {
+    const auto it = arguments.find(name);
+    if (it == arguments.end()) {
+        return default_value;
+    }
+    const string value = it->second;
+    arguments.erase(it);
+    return value;
+}
+
+void CheckNoArgumentsLeft(const map<string, string>& arguments) {
+    if (!arguments.empty()) {
+        throw invalid_argument("Unknown option --"s + arguments.begin()->first);
+    }
+}
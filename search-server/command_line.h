@@ -0,0 +1,13 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+// Аргументы вида --name value: имя без "--" -> значение
+std::map<std::string, std::string> ParseArguments(int argc, char* argv[]);
+// Значение аргумента name или default_value; прочитанный аргумент удаляется из arguments,
+// чтобы в конце оставшиеся можно было сообщить как неизвестные
+std::string GetArgument(std::map<std::string, std::string>& arguments, const std::string& name,
+                        const std::string& default_value);
+// Бросает invalid_argument, если в arguments остались непрочитанные аргументы
+void CheckNoArgumentsLeft(const std::map<std::string, std::string>& arguments);
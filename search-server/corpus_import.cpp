@@ -0,0 +1,333 @@
+#include "corpus_import.h"
+
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Cannot open "s + path);
+        }
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw runtime_error("Cannot stat "s + path);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("Cannot map "s + path);
+            }
+            madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    string_view GetContent() const {
+        return {data_, size_};
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct DocumentBatch {
+    vector<PreparedDocument> documents;
+    size_t byte_count = 0;
+};
+
+// Выдаёт потокам разбора куски файла по batch_size строк с порядковыми номерами.
+// Под блокировкой выполняется только поиск переводов строк.
+class RecordSplitter {
+public:
+    RecordSplitter(string_view content, size_t batch_size)
+        : content_(content)
+        , batch_size_(batch_size) {
+    }
+
+    bool Next(string_view& records, size_t& sequence_number) {
+        lock_guard guard(mutex_);
+        if (content_.empty()) {
+            return false;
+        }
+        size_t end = 0;
+        for (size_t i = 0; i < batch_size_ && end < content_.size(); ++i) {
+            const void* line_end = memchr(content_.data() + end, '\n', content_.size() - end);
+            end = line_end == nullptr ? content_.size() : static_cast<const char*>(line_end) - content_.data() + 1;
+        }
+        records = content_.substr(0, end);
+        content_.remove_prefix(end);
+        sequence_number = next_sequence_number_++;
+        return true;
+    }
+
+private:
+    string_view content_;
+    const size_t batch_size_;
+    size_t next_sequence_number_ = 0;
+    mutex mutex_;
+};
+
+// Очередь пакетов между потоками разбора и потоком, добавляющим документы.
+// Пакеты выдаются в порядке следования в файле: id обычно растут вдоль файла,
+// и документы попадают в конец списков документов слов. Пакет, опережающий
+// выдачу на capacity и больше, ждёт, поэтому разбор не убегает вперёд индекса.
+class BatchQueue {
+public:
+    BatchQueue(size_t capacity, size_t producer_count)
+        : capacity_(max<size_t>(capacity, 1))
+        , producer_count_(producer_count) {
+    }
+
+    // false - очередь закрыта, пакет не принят
+    bool Push(size_t sequence_number, DocumentBatch batch) {
+        unique_lock lock(mutex_);
+        has_space_.wait(lock, [this, sequence_number] {
+            return closed_ || sequence_number < next_sequence_number_ + capacity_;
+        });
+        if (closed_) {
+            return false;
+        }
+        batches_.emplace(sequence_number, move(batch));
+        if (sequence_number == next_sequence_number_) {
+            has_batch_.notify_one();
+        }
+        return true;
+    }
+
+    // false - пакетов больше не будет
+    bool Pop(DocumentBatch& batch) {
+        unique_lock lock(mutex_);
+        has_batch_.wait(lock, [this] {
+            return closed_ || IsNextReady() || (producer_count_ == 0 && batches_.empty());
+        });
+        if (closed_ || !IsNextReady()) {
+            return false;
+        }
+        const auto it = batches_.begin();
+        batch = move(it->second);
+        batches_.erase(it);
+        ++next_sequence_number_;
+        has_space_.notify_all();
+        return true;
+    }
+
+    void FinishProducer() {
+        lock_guard guard(mutex_);
+        if (--producer_count_ == 0) {
+            has_batch_.notify_all();
+        }
+    }
+
+    // прерывает обмен с обеих сторон, error (если есть) сохраняется для вызывающего потока
+    void Close(exception_ptr error = nullptr) {
+        lock_guard guard(mutex_);
+        if (!error_) {
+            error_ = error;
+        }
+        closed_ = true;
+        has_batch_.notify_all();
+        has_space_.notify_all();
+    }
+
+    exception_ptr GetError() {
+        lock_guard guard(mutex_);
+        return error_;
+    }
+
+private:
+    bool IsNextReady() const {
+        return !batches_.empty() && batches_.begin()->first == next_sequence_number_;
+    }
+
+    const size_t capacity_;
+    size_t producer_count_;
+    map<size_t, DocumentBatch> batches_;
+    size_t next_sequence_number_ = 0;
+    bool closed_ = false;
+    exception_ptr error_;
+    mutex mutex_;
+    condition_variable has_batch_;
+    condition_variable has_space_;
+};
+
+DocumentStatus ParseStatus(string_view name) {
+    for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+                                        DocumentStatus::BANNED, DocumentStatus::REMOVED}) {
+        if (name == GetStatusName(status)) {
+            return status;
+        }
+    }
+    throw invalid_argument("Unknown document status "s + string(name));
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc{} || end != text.data() + text.size()) {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+string_view CutField(string_view& record) {
+    const size_t tab_pos = record.find('\t');
+    if (tab_pos == record.npos) {
+        throw invalid_argument("Corpus record has too few fields"s);
+    }
+    const string_view field = record.substr(0, tab_pos);
+    record.remove_prefix(tab_pos + 1);
+    return field;
+}
+
+// Разбирает куски файла, пока они не кончатся или очередь не закроется
+void ParseRecords(const SearchServer& search_server, RecordSplitter& splitter, BatchQueue& queue) {
+    vector<int> ratings;
+    string_view records;
+    size_t sequence_number = 0;
+    while (splitter.Next(records, sequence_number)) {
+        DocumentBatch batch;
+        batch.byte_count = records.size();
+        while (!records.empty()) {
+            const size_t line_end = min(records.find('\n'), records.size());
+            string_view record = records.substr(0, line_end);
+            records.remove_prefix(min(line_end + 1, records.size()));
+            if (!record.empty() && record.back() == '\r') {
+                record.remove_suffix(1);
+            }
+            if (!record.empty()) {
+                batch.documents.push_back(ParseCorpusRecord(search_server, record, ratings));
+            }
+        }
+        if (!queue.Push(sequence_number, move(batch))) {
+            return;
+        }
+    }
+}
+
+}  // namespace
+
+string_view GetStatusName(DocumentStatus status) {
+    switch (status) {
+    case DocumentStatus::ACTUAL:
+        return "ACTUAL"sv;
+    case DocumentStatus::IRRELEVANT:
+        return "IRRELEVANT"sv;
+    case DocumentStatus::BANNED:
+        return "BANNED"sv;
+    case DocumentStatus::REMOVED:
+        return "REMOVED"sv;
+    }
+    throw invalid_argument("Unknown document status"s);
+}
+
+PreparedDocument ParseCorpusRecord(const SearchServer& search_server, string_view record, vector<int>& ratings_buffer) {
+    const int document_id = ParseInt(CutField(record));
+    const DocumentStatus status = ParseStatus(CutField(record));
+    string_view ratings_field = CutField(record);
+    ratings_buffer.clear();
+    while (!ratings_field.empty()) {
+        const size_t comma_pos = min(ratings_field.find(','), ratings_field.size());
+        ratings_buffer.push_back(ParseInt(ratings_field.substr(0, comma_pos)));
+        ratings_field.remove_prefix(min(comma_pos + 1, ratings_field.size()));
+    }
+    return search_server.PrepareDocument(document_id, record, status, ratings_buffer);
+}
+
+CorpusImportProgress ImportCorpus(SearchServer& search_server, const string& path, const CorpusImportOptions& options) {
+    const auto start_time = chrono::steady_clock::now();
+    const MappedFile file(path);
+    const string_view content = file.GetContent();
+
+    CorpusImportProgress progress;
+    progress.total_bytes = content.size();
+    size_t reported_count = 0;
+    const auto report = [&] {
+        reported_count = progress.document_count;
+        if (options.progress) {
+            progress.elapsed = chrono::steady_clock::now() - start_time;
+            options.progress(progress);
+        }
+    };
+
+    const size_t worker_count = options.worker_threads != 0 ? options.worker_threads
+                                                            : max(1u, thread::hardware_concurrency());
+    RecordSplitter splitter(content, max<size_t>(options.batch_size, 1));
+    BatchQueue queue(options.queue_capacity, worker_count);
+
+    vector<thread> workers;
+    workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back([&search_server, &splitter, &queue] {
+            try {
+                ParseRecords(search_server, splitter, queue);
+            } catch (...) {
+                queue.Close(current_exception());
+            }
+            queue.FinishProducer();
+        });
+    }
+
+    // документы добавляет только этот поток, поэтому сервер не нужно защищать
+    size_t next_report = options.progress_interval;
+    try {
+        DocumentBatch batch;
+        while (queue.Pop(batch)) {
+            for (PreparedDocument& document : batch.documents) {
+                search_server.AddDocument(move(document));
+            }
+            progress.document_count += batch.documents.size();
+            progress.processed_bytes += batch.byte_count;
+            if (options.progress_interval != 0 && progress.document_count >= next_report) {
+                report();
+                next_report += (progress.document_count - next_report) / options.progress_interval * options.progress_interval
+                               + options.progress_interval;
+            }
+        }
+    } catch (...) {
+        queue.Close(current_exception());
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (const auto error = queue.GetError()) {
+        rethrow_exception(error);
+    }
+
+    progress.processed_bytes = content.size();
+    progress.elapsed = chrono::steady_clock::now() - start_time;
+    if (progress.document_count != reported_count) {
+        report();
+    }
+    return progress;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+// Состояние импорта, передаётся в CorpusImportOptions::progress
+struct CorpusImportProgress {
+    size_t document_count = 0;
+    size_t processed_bytes = 0;
+    size_t total_bytes = 0;
+    std::chrono::duration<double> elapsed{};
+
+    double GetDocumentsPerSecond() const {
+        return elapsed.count() > 0 ? document_count / elapsed.count() : 0.0;
+    }
+};
+
+struct CorpusImportOptions {
+    // потоков разбора записей, 0 - по числу ядер
+    size_t worker_threads = 0;
+    // записей в одном пакете, передаваемом в индекс
+    size_t batch_size = 1024;
+    // сколько разобранных пакетов может ждать добавления в индекс
+    size_t queue_capacity = 16;
+    // вызывается из потока импорта каждые progress_interval документов и в конце
+    std::function<void(const CorpusImportProgress&)> progress;
+    size_t progress_interval = 100'000;
+};
+
+// Загружает корпус из файла: одна запись на строку,
+// поля через табуляцию - id, статус (ACTUAL, IRRELEVANT, BANNED, REMOVED),
+// рейтинги через запятую (могут отсутствовать) и текст документа.
+// Файл отображается в память и раздаётся потокам пакетами по batch_size строк; потоки
+// разбирают пакеты на слова, а вызывающий поток добавляет их в сервер в порядке файла
+// через очередь ограниченного размера. Ошибка в любой записи прерывает импорт исключением,
+// документы из уже добавленных пакетов остаются в сервере.
+CorpusImportProgress ImportCorpus(SearchServer& search_server, const std::string& path, const CorpusImportOptions& options = {});
+
+// Разбор одной записи корпуса без перевода строки
+PreparedDocument ParseCorpusRecord(const SearchServer& search_server, std::string_view record, std::vector<int>& ratings_buffer);
+
+// Имя статуса в записи корпуса
+std::string_view GetStatusName(DocumentStatus status);
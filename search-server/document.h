@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <iostream>
 #include <string>
 
+class SearchServer;
+
 
 enum class DocumentStatus {
     ACTUAL,
@@ -20,3 +23,42 @@ struct Document {
     int rating = 0;
 };
 
+// Результат запроса с ограничением по времени: truncated = true,
+// если запрос был прерван и документы найдены не по всему индексу
+struct SearchResult {
+    std::vector<Document> documents;
+    bool truncated = false;
+};
+
+// Позиция в выдаче для постраничного поиска. Документы упорядочены по убыванию
+// релевантности, затем рейтинга, затем по возрастанию id; следующая страница
+// начинается сразу после документа, на котором закончилась предыдущая.
+// Курсор по умолчанию указывает на начало выдачи.
+class SearchCursor {
+public:
+    SearchCursor() = default;
+
+    // выдача исчерпана, следующих страниц нет
+    bool IsEnd() const {
+        return is_end_;
+    }
+
+private:
+    friend class SearchServer;
+
+    bool is_start_ = true;
+    bool is_end_ = false;
+    double relevance_ = 0.0;
+    int rating_ = 0;
+    int document_id_ = 0;
+    // поколение индекса, на котором получена страница
+    uint64_t generation_ = 0;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    SearchCursor next;
+    // индекс менялся после получения курсора: страница продолжает выдачу
+    // с того же места, но релевантности могли сдвинуться
+    bool index_changed = false;
+};
@@ -4,23 +4,52 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
+        benchmark_functions.cpp \
+        bloom_filter.cpp \
+        corpus_import.cpp \
         document.cpp \
         main.cpp \
+        positional_index.cpp \
         process_queries.cpp \
+        query_analytics.cpp \
+        query_executor.cpp \
+        query_planner.cpp \
+        roaring_bitmap.cpp \
         read_input_functions.cpp \
         request_queue.cpp \
         search_server.cpp \
+        standing_query_index.cpp \
+        stop_word_set.cpp \
         string_processing.cpp \
-        test_example_functions.cpp
+        term_dictionary.cpp \
+        test_example_functions.cpp \
+        top_document_list.cpp \
+        write_ahead_log.cpp
 
 HEADERS += \
+    benchmark_functions.h \
+    bloom_filter.h \
     concurrent_map.h \
+    corpus_import.h \
     document.h \
     log_duration.h \
     paginator.h \
+    positional_index.h \
     process_queries.h \
+    query_analytics.h \
+    query_control.h \
+    query_executor.h \
+    query_planner.h \
     read_input_functions.h \
     request_queue.h \
+    roaring_bitmap.h \
     search_server.h \
+    sorted_intersection.h \
+    standing_query_index.h \
+    stop_word_set.h \
     string_processing.h \
-    test_example_functions.h
+    term_dictionary.h \
+    test_example_functions.h \
+    top_document_list.h \
+    word_hash.h \
+    write_ahead_log.h
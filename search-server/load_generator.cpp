@@ -0,0 +1,334 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Schedule {
+    Clock::time_point start;
+    Clock::time_point deadline;
+    // после этого момента не начинается ни одна операция, даже отставшая от расписания
+    Clock::time_point hard_deadline;
+};
+
+struct OperationStats {
+    LatencyHistogram latencies;
+    uint64_t errors = 0;
+};
+
+template <typename Operation>
+void RunMeasured(Operation& operation, uint64_t index, Clock::time_point start, OperationStats& stats) {
+    try {
+        operation(index);
+    } catch (const exception&) {
+        ++stats.errors;
+    }
+    stats.latencies.Record(Clock::now() - start);
+}
+
+// Следующая операция начинается сразу после предыдущей
+template <typename Operation>
+void RunClosedLoop(const Schedule& schedule, atomic<uint64_t>& next_index, Operation operation, OperationStats& stats) {
+    this_thread::sleep_until(schedule.start);
+    while (true) {
+        const Clock::time_point start = Clock::now();
+        if (start >= schedule.deadline) {
+            return;
+        }
+        RunMeasured(operation, next_index.fetch_add(1, memory_order_relaxed), start, stats);
+    }
+}
+
+// Операция index запланирована на start + index / rate. Задержка отсчитывается от
+// запланированного момента, а не от фактического начала, иначе время ожидания в
+// очереди перед медленным сервером выпадает из статистики (coordinated omission)
+template <typename Operation>
+void RunOpenLoop(const Schedule& schedule, double rate, atomic<uint64_t>& next_index, Operation operation,
+                 OperationStats& stats) {
+    const chrono::duration<double> interval(1.0 / rate);
+    while (true) {
+        const uint64_t index = next_index.fetch_add(1, memory_order_relaxed);
+        const Clock::time_point intended = schedule.start + chrono::duration_cast<Clock::duration>(interval * index);
+        if (intended >= schedule.deadline) {
+            return;
+        }
+        this_thread::sleep_until(intended);
+        if (Clock::now() >= schedule.hard_deadline) {
+            return;
+        }
+        RunMeasured(operation, index, intended, stats);
+    }
+}
+
+// Запланированные, но не начатые операции. Число запланированных округляется вверх, а
+// операция с моментом ровно на границе не начинается, поэтому начатых может оказаться больше.
+uint64_t GetUnfinishedCount(chrono::milliseconds duration, double rate, uint64_t started) {
+    const auto scheduled = static_cast<uint64_t>(ceil(chrono::duration<double>(duration).count() * rate));
+    return started >= scheduled ? 0 : scheduled - started;
+}
+
+OperationReport MakeReport(string name, const vector<OperationStats>& stats, Clock::duration elapsed) {
+    OperationReport report;
+    report.name = move(name);
+    for (const OperationStats& thread_stats : stats) {
+        report.latencies.Merge(thread_stats.latencies);
+        report.errors += thread_stats.errors;
+    }
+    report.count = report.latencies.GetCount();
+    report.throughput = report.count / chrono::duration<double>(elapsed).count();
+    return report;
+}
+
+string GenerateDocumentText(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& words,
+                            int max_word_count) {
+    string text;
+    const int word_count = uniform_int_distribution(1, max(max_word_count, 1))(generator);
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += dictionary[words(generator)];
+    }
+    return text;
+}
+
+}  // namespace
+
+void LatencyHistogram::Record(chrono::nanoseconds latency) {
+    const uint64_t value = static_cast<uint64_t>(max<int64_t>(latency.count(), 0));
+    ++counts_[GetBucket(value)];
+    ++count_;
+    max_ = max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    max_ = max(max_, other.max_);
+}
+
+chrono::nanoseconds LatencyHistogram::GetPercentile(double q) const {
+    if (count_ == 0) {
+        return chrono::nanoseconds(0);
+    }
+    const uint64_t rank = max<uint64_t>(static_cast<uint64_t>(ceil(q * count_)), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += counts_[bucket];
+        if (seen >= rank) {
+            return chrono::nanoseconds(min(GetBucketUpperBound(bucket), max_));
+        }
+    }
+    return GetMax();
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    const int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const size_t shift = bucket / SUB_BUCKET_COUNT - 1;
+    const uint64_t mantissa = SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent) {
+    if (size == 0) {
+        throw invalid_argument("Zipf distribution needs at least one value"s);
+    }
+    cumulative_weights_.reserve(size);
+    double total = 0;
+    for (size_t rank = 1; rank <= size; ++rank) {
+        total += 1.0 / pow(static_cast<double>(rank), exponent);
+        cumulative_weights_.push_back(total);
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    const double x = uniform_real_distribution(0.0, cumulative_weights_.back())(generator);
+    const auto it = upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), x);
+    return min<size_t>(it - cumulative_weights_.begin(), cumulative_weights_.size() - 1);
+}
+
+vector<string> GenerateZipfianQueries(mt19937& generator, const vector<string>& dictionary, size_t query_count,
+                                      double exponent, int max_word_count) {
+    const ZipfDistribution words(dictionary.size(), exponent);
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateDocumentText(generator, dictionary, words, max_word_count));
+    }
+    return queries;
+}
+
+vector<string> ReadQueryLog(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    vector<string> queries;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            queries.push_back(move(line));
+        }
+    }
+    return queries;
+}
+
+vector<OperationReport> RunLoad(SearchServer& search_server, const vector<string>& queries,
+                                const vector<string>& dictionary, const LoadGeneratorOptions& options) {
+    if (queries.empty()) {
+        throw invalid_argument("Query set is empty"s);
+    }
+    if (options.threads == 0) {
+        throw invalid_argument("At least one query thread is required"s);
+    }
+    if (options.mode == LoadMode::OPEN_LOOP && options.target_qps <= 0) {
+        throw invalid_argument("Open-loop mode requires a positive target QPS"s);
+    }
+    if ((options.add_rate > 0 || options.remove_rate > 0) && dictionary.empty()) {
+        throw invalid_argument("Background updates require a dictionary"s);
+    }
+
+    SharedSearchServer shared_server(search_server);
+    // документы удаляются в порядке добавления, начиная с уже имеющихся в индексе
+    deque<int> removable_ids(search_server.begin(), search_server.end());
+    mutex removable_mutex;
+    atomic<int> next_document_id = removable_ids.empty() ? 0 : removable_ids.back() + 1;
+
+    const auto search = [&](uint64_t index) {
+        const string& query = queries[index % queries.size()];
+        shared_server.Read([&](const SearchServer& server) {
+            return options.parallel_queries ? server.FindTopDocuments(execution::par, query).size()
+                                            : server.FindTopDocuments(execution::seq, query).size();
+        });
+    };
+
+    const ZipfDistribution document_words(max<size_t>(dictionary.size(), 1), 1.0);
+    mt19937 add_generator(options.seed);
+    const auto add = [&](uint64_t) {
+        const int document_id = next_document_id.fetch_add(1, memory_order_relaxed);
+        const string text = GenerateDocumentText(add_generator, dictionary, document_words, options.max_document_words);
+        // разбор на слова не меняет сервер и идёт под разделяемой блокировкой
+        PreparedDocument document = shared_server.Read([&](const SearchServer& server) {
+            return server.PrepareDocument(document_id, text, DocumentStatus::ACTUAL, {1});
+        });
+        shared_server.Write([&](SearchServer& server) {
+            server.AddDocument(move(document));
+        });
+        lock_guard guard(removable_mutex);
+        removable_ids.push_back(document_id);
+    };
+
+    const auto remove = [&](uint64_t) {
+        int document_id = 0;
+        {
+            lock_guard guard(removable_mutex);
+            if (removable_ids.empty()) {
+                return;
+            }
+            document_id = removable_ids.front();
+            removable_ids.pop_front();
+        }
+        shared_server.Write([document_id](SearchServer& server) {
+            server.RemoveDocument(document_id);
+        });
+    };
+
+    Schedule schedule;
+    // потоки успевают запуститься до начала расписания
+    schedule.start = Clock::now() + 10ms;
+    schedule.deadline = schedule.start + options.duration;
+    schedule.hard_deadline = schedule.deadline + options.duration;
+
+    vector<OperationStats> search_stats(options.threads);
+    vector<OperationStats> add_stats(1);
+    vector<OperationStats> remove_stats(1);
+    atomic<uint64_t> next_search{0};
+    atomic<uint64_t> next_add{0};
+    atomic<uint64_t> next_remove{0};
+
+    vector<thread> threads;
+    for (size_t i = 0; i < options.threads; ++i) {
+        threads.emplace_back([&, i] {
+            if (options.mode == LoadMode::OPEN_LOOP) {
+                RunOpenLoop(schedule, options.target_qps, next_search, search, search_stats[i]);
+            } else {
+                RunClosedLoop(schedule, next_search, search, search_stats[i]);
+            }
+        });
+    }
+    if (options.add_rate > 0) {
+        threads.emplace_back([&] {
+            RunOpenLoop(schedule, options.add_rate, next_add, add, add_stats[0]);
+        });
+    }
+    if (options.remove_rate > 0) {
+        threads.emplace_back([&] {
+            RunOpenLoop(schedule, options.remove_rate, next_remove, remove, remove_stats[0]);
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    const Clock::duration elapsed = max(Clock::now(), schedule.deadline) - schedule.start;
+
+    vector<OperationReport> reports;
+    reports.push_back(MakeReport("search"s, search_stats, elapsed));
+    if (options.mode == LoadMode::OPEN_LOOP) {
+        reports.back().unfinished = GetUnfinishedCount(options.duration, options.target_qps, reports.back().count);
+    }
+    if (options.add_rate > 0) {
+        reports.push_back(MakeReport("add"s, add_stats, elapsed));
+        reports.back().unfinished = GetUnfinishedCount(options.duration, options.add_rate, reports.back().count);
+    }
+    if (options.remove_rate > 0) {
+        reports.push_back(MakeReport("remove"s, remove_stats, elapsed));
+        reports.back().unfinished = GetUnfinishedCount(options.duration, options.remove_rate, reports.back().count);
+    }
+    return reports;
+}
+
+void PrintLoadReport(ostream& out, const vector<OperationReport>& reports) {
+    const auto to_microseconds = [](chrono::nanoseconds latency) {
+        return chrono::duration<double, micro>(latency).count();
+    };
+    out << left << setw(10) << "operation"s << right << setw(10) << "count"s << setw(8) << "errors"s
+        << setw(12) << "unfinished"s << setw(12) << "ops/s"s << setw(12) << "p50 us"s << setw(12) << "p99 us"s
+        << setw(12) << "p999 us"s << setw(12) << "max us"s << endl;
+    out << fixed << setprecision(1);
+    for (const OperationReport& report : reports) {
+        out << left << setw(10) << report.name << right << setw(10) << report.count << setw(8) << report.errors
+            << setw(12) << report.unfinished << setw(12) << report.throughput
+            << setw(12) << to_microseconds(report.latencies.GetPercentile(0.5))
+            << setw(12) << to_microseconds(report.latencies.GetPercentile(0.99))
+            << setw(12) << to_microseconds(report.latencies.GetPercentile(0.999))
+            << setw(12) << to_microseconds(report.latencies.GetMax()) << endl;
+    }
+    out << defaultfloat;
+}
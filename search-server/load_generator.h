@@ -0,0 +1,125 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// Гистограмма задержек в наносекундах с относительной погрешностью не больше 1/32:
+// значение попадает в одну из 32 равных частей своего интервала [2^k, 2^(k+1))
+class LatencyHistogram {
+public:
+    void Record(std::chrono::nanoseconds latency);
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+    // Наименьшая задержка, не меньше которой q-я доля всех записанных (0 < q <= 1);
+    // значение округляется вверх до границы корзины
+    std::chrono::nanoseconds GetPercentile(double q) const;
+    std::chrono::nanoseconds GetMax() const {
+        return std::chrono::nanoseconds(max_);
+    }
+
+private:
+    static const int SUB_BUCKET_BITS = 5;
+    static const size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+    static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t bucket);
+
+    std::array<uint64_t, BUCKET_COUNT> counts_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Сервер под shared_mutex: поиски выполняются параллельно,
+// добавление и удаление документов - под исключительной блокировкой
+class SharedSearchServer {
+public:
+    explicit SharedSearchServer(SearchServer& search_server)
+        : search_server_(search_server) {
+    }
+
+    template <typename Function>
+    auto Read(Function function) const {
+        std::shared_lock lock(mutex_);
+        return function(static_cast<const SearchServer&>(search_server_));
+    }
+
+    template <typename Function>
+    auto Write(Function function) {
+        std::unique_lock lock(mutex_);
+        return function(search_server_);
+    }
+
+private:
+    SearchServer& search_server_;
+    mutable std::shared_mutex mutex_;
+};
+
+enum class LoadMode {
+    // threads потоков отправляют следующий запрос сразу после ответа на предыдущий
+    CLOSED_LOOP,
+    // запросы отправляются по расписанию с частотой target_qps, задержка отсчитывается
+    // от запланированного момента: очередь перед перегруженным сервером входит в задержку
+    OPEN_LOOP,
+};
+
+struct LoadGeneratorOptions {
+    LoadMode mode = LoadMode::CLOSED_LOOP;
+    size_t threads = 4;
+    double target_qps = 1000;
+    std::chrono::milliseconds duration{10'000};
+    // фоновые добавления и удаления документов в секунду, всегда по расписанию
+    double add_rate = 0;
+    double remove_rate = 0;
+    // слов в добавляемом документе
+    int max_document_words = 20;
+    bool parallel_queries = false;
+    uint32_t seed = 42;
+};
+
+struct OperationReport {
+    std::string name;
+    uint64_t count = 0;
+    // запросы, на которые сервер ответил исключением
+    uint64_t errors = 0;
+    // операции по расписанию, которые не успели начаться до конца прогона
+    uint64_t unfinished = 0;
+    // операций в секунду
+    double throughput = 0;
+    LatencyHistogram latencies;
+};
+
+// Частоты слов по закону Ципфа: слово ранга r выбирается с вероятностью, пропорциональной 1 / r^exponent
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+// Запросы из 1..max_word_count слов словаря, слова выбираются по закону Ципфа
+std::vector<std::string> GenerateZipfianQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                                                size_t query_count, double exponent, int max_word_count);
+// Журнал запросов: один запрос в строке, пустые строки пропускаются
+std::vector<std::string> ReadQueryLog(const std::string& path);
+
+// Нагружает сервер запросами из queries (по кругу) и фоновыми изменениями, тексты новых
+// документов составляются из слов dictionary. Документы удаляются, начиная с самых старых.
+std::vector<OperationReport> RunLoad(SearchServer& search_server, const std::vector<std::string>& queries,
+                                     const std::vector<std::string>& dictionary, const LoadGeneratorOptions& options);
+
+void PrintLoadReport(std::ostream& out, const std::vector<OperationReport>& reports);
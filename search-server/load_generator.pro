@@ -0,0 +1,57 @@
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = load_generator
+
+SOURCES += \
+        benchmark_functions.cpp \
+        bloom_filter.cpp \
+        command_line.cpp \
+        corpus_import.cpp \
+        document.cpp \
+        load_generator.cpp \
+        load_generator_main.cpp \
+        positional_index.cpp \
+        process_queries.cpp \
+        query_analytics.cpp \
+        query_executor.cpp \
+        query_planner.cpp \
+        roaring_bitmap.cpp \
+        read_input_functions.cpp \
+        request_queue.cpp \
+        search_server.cpp \
+        standing_query_index.cpp \
+        stop_word_set.cpp \
+        string_processing.cpp \
+        term_dictionary.cpp \
+        top_document_list.cpp \
+        write_ahead_log.cpp
+
+HEADERS += \
+    benchmark_functions.h \
+    bloom_filter.h \
+    command_line.h \
+    concurrent_map.h \
+    corpus_import.h \
+    document.h \
+    load_generator.h \
+    log_duration.h \
+    positional_index.h \
+    process_queries.h \
+    query_analytics.h \
+    query_control.h \
+    query_executor.h \
+    query_planner.h \
+    read_input_functions.h \
+    request_queue.h \
+    roaring_bitmap.h \
+    search_server.h \
+    sorted_intersection.h \
+    standing_query_index.h \
+    stop_word_set.h \
+    string_processing.h \
+    term_dictionary.h \
+    top_document_list.h \
+    word_hash.h \
+    write_ahead_log.h
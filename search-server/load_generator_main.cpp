@@ -0,0 +1,99 @@
+#include "benchmark_functions.h"
+#include "command_line.h"
+#include "corpus_import.h"
+#include "load_generator.h"
+#include "log_duration.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string USAGE =
+    "Usage: load_generator [options]\n"
+    "  --mode closed|open     closed loop (default) or open loop at --qps\n"
+    "  --threads N            query threads (default 4)\n"
+    "  --qps Q                target queries per second in open-loop mode (default 1000)\n"
+    "  --duration SECONDS     run time (default 10)\n"
+    "  --queries FILE         query log, one query per line (default: Zipfian queries)\n"
+    "  --query-count N        number of generated queries (default 10000)\n"
+    "  --zipf S               exponent of generated word frequencies (default 1.0)\n"
+    "  --corpus FILE          corpus for ImportCorpus (default: generated documents)\n"
+    "  --documents N          number of generated documents (default 100000)\n"
+    "  --add-rate R           background AddDocument calls per second (default 0)\n"
+    "  --remove-rate R        background RemoveDocument calls per second (default 0)\n"
+    "  --policy seq|par       execution policy of queries (default seq)\n"
+    "  --seed N               random seed (default 42)\n"s;
+
+// Слова для новых документов берутся из уже загруженных
+vector<string> CollectDictionary(const SearchServer& search_server, size_t document_count) {
+    set<string> words;
+    for (const int document_id : search_server) {
+        if (document_count-- == 0) {
+            break;
+        }
+        for (const auto& [word, freq] : search_server.GetWordFrequencies(document_id)) {
+            words.emplace(word);
+        }
+    }
+    return {words.begin(), words.end()};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        map<string, string> arguments = ParseArguments(argc, argv);
+        LoadGeneratorOptions options;
+        const string mode = GetArgument(arguments, "mode"s, "closed"s);
+        if (mode != "closed"s && mode != "open"s) {
+            throw invalid_argument("Unknown mode "s + mode);
+        }
+        options.mode = mode == "open"s ? LoadMode::OPEN_LOOP : LoadMode::CLOSED_LOOP;
+        options.threads = stoul(GetArgument(arguments, "threads"s, "4"s));
+        options.target_qps = stod(GetArgument(arguments, "qps"s, "1000"s));
+        options.duration = chrono::milliseconds(static_cast<int64_t>(stod(GetArgument(arguments, "duration"s, "10"s)) * 1000));
+        options.add_rate = stod(GetArgument(arguments, "add-rate"s, "0"s));
+        options.remove_rate = stod(GetArgument(arguments, "remove-rate"s, "0"s));
+        const string policy = GetArgument(arguments, "policy"s, "seq"s);
+        if (policy != "seq"s && policy != "par"s) {
+            throw invalid_argument("Unknown policy "s + policy);
+        }
+        options.parallel_queries = policy == "par"s;
+        options.seed = static_cast<uint32_t>(stoul(GetArgument(arguments, "seed"s, "42"s)));
+        const string query_log = GetArgument(arguments, "queries"s, ""s);
+        const size_t query_count = stoul(GetArgument(arguments, "query-count"s, "10000"s));
+        const double zipf_exponent = stod(GetArgument(arguments, "zipf"s, "1.0"s));
+        const string corpus = GetArgument(arguments, "corpus"s, ""s);
+        const int document_count = stoi(GetArgument(arguments, "documents"s, "100000"s));
+        CheckNoArgumentsLeft(arguments);
+
+        mt19937 generator(options.seed);
+        SearchServer search_server("and in at with"s);
+        vector<string> dictionary;
+        {
+            LOG_DURATION("indexing"sv);
+            if (!corpus.empty()) {
+                ImportCorpus(search_server, corpus);
+                dictionary = CollectDictionary(search_server, 10'000);
+            } else {
+                dictionary = GenerateDictionary(generator, 20'000, 10);
+                FillBenchmarkServer(search_server, generator, dictionary, document_count, 20);
+            }
+        }
+        const vector<string> queries = query_log.empty()
+                                           ? GenerateZipfianQueries(generator, dictionary, query_count, zipf_exponent, 3)
+                                           : ReadQueryLog(query_log);
+        cerr << search_server.GetDocumentCount() << " documents, "s << queries.size() << " queries"s << endl;
+
+        PrintLoadReport(cout, RunLoad(search_server, queries, dictionary, options));
+    } catch (const exception& e) {
+        cerr << e.what() << endl << USAGE;
+        return 1;
+    }
+    return 0;
+}
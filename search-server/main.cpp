@@ -1,5 +1,7 @@
+#include "benchmark_functions.h"
 #include "process_queries.h"
 #include "search_server.h"
+#include "test_example_functions.h"
 
 #include <execution>
 #include <iostream>
@@ -15,7 +17,16 @@ void PrintDocument(const Document& document) {
          << "rating = "s << document.rating << " }"s << endl;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1] == "--benchmark"s) {
+        RunBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && argv[1] == "--test"s) {
+        RunTests();
+        return 0;
+    }
+
     SearchServer search_server("and with"s);
 
     int id = 0;
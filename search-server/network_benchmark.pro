@@ -0,0 +1,63 @@
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+TARGET = network_benchmark
+
+SOURCES += \
+        benchmark_functions.cpp \
+        bloom_filter.cpp \
+        command_line.cpp \
+        corpus_import.cpp \
+        document.cpp \
+        load_generator.cpp \
+        network_benchmark_main.cpp \
+        network_client.cpp \
+        network_protocol.cpp \
+        network_server.cpp \
+        positional_index.cpp \
+        process_queries.cpp \
+        query_analytics.cpp \
+        query_executor.cpp \
+        query_planner.cpp \
+        read_input_functions.cpp \
+        request_queue.cpp \
+        roaring_bitmap.cpp \
+        search_server.cpp \
+        standing_query_index.cpp \
+        stop_word_set.cpp \
+        string_processing.cpp \
+        term_dictionary.cpp \
+        top_document_list.cpp \
+        write_ahead_log.cpp
+
+HEADERS += \
+    benchmark_functions.h \
+    bloom_filter.h \
+    command_line.h \
+    concurrent_map.h \
+    corpus_import.h \
+    document.h \
+    load_generator.h \
+    log_duration.h \
+    network_client.h \
+    network_protocol.h \
+    network_server.h \
+    positional_index.h \
+    process_queries.h \
+    query_analytics.h \
+    query_control.h \
+    query_executor.h \
+    query_planner.h \
+    read_input_functions.h \
+    request_queue.h \
+    roaring_bitmap.h \
+    search_server.h \
+    sorted_intersection.h \
+    standing_query_index.h \
+    stop_word_set.h \
+    string_processing.h \
+    term_dictionary.h \
+    top_document_list.h \
+    word_hash.h \
+    write_ahead_log.h
@@ -0,0 +1,173 @@
+#include "benchmark_functions.h"
+#include "command_line.h"
+#include "load_generator.h"
+#include "log_duration.h"
+#include "network_client.h"
+#include "network_server.h"
+
+#include <atomic>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const string USAGE =
+    "Usage: network_benchmark [options]\n"
+    "  --connect ADDRESS      tcp:HOST:PORT or unix:PATH of a running search_service;\n"
+    "                         by default the benchmark starts a server in this process\n"
+    "  --transport unix|tcp   transport of the in-process server (default unix)\n"
+    "  --documents N          documents of the in-process server (default 100000)\n"
+    "  --batch N              max batch size of the in-process server (default 256)\n"
+    "  --connections N        client connections, one thread each (default 4)\n"
+    "  --pipeline N           requests in flight per connection (default 8)\n"
+    "  --duration SECONDS     run time (default 5)\n"
+    "  --queries FILE         query log, one query per line (default: Zipfian queries)\n"
+    "  --query-count N        number of generated queries (default 10000)\n"
+    "  --zipf S               exponent of generated word frequencies (default 1.0)\n"
+    "  --seed N               random seed (default 42)\n"s;
+
+struct ConnectionStats {
+    LatencyHistogram latencies;
+    uint64_t errors = 0;
+};
+
+// Замкнутый цикл с конвейером: в соединении всегда pipeline запросов без ответа,
+// следующий отправляется по приходу ответа. Задержка - от отправки до ответа.
+void RunConnection(const string& address, const vector<string>& queries, size_t first_query, size_t pipeline,
+                   Clock::time_point deadline, ConnectionStats& stats) {
+    SearchClient client = SearchClient::Connect(address);
+    deque<Clock::time_point> sent;
+    size_t query_index = first_query;
+    const auto send_next = [&] {
+        NetworkRequest request;
+        request.type = RequestType::SEARCH;
+        request.text = queries[query_index++ % queries.size()];
+        sent.push_back(Clock::now());
+        client.Send(move(request));
+    };
+    for (size_t i = 0; i < pipeline; ++i) {
+        send_next();
+    }
+    while (!sent.empty()) {
+        const NetworkResponse response = client.Receive();
+        const Clock::time_point now = Clock::now();
+        stats.latencies.Record(now - sent.front());
+        sent.pop_front();
+        stats.errors += response.status == ResponseStatus::ERROR;
+        if (now < deadline) {
+            send_next();
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        map<string, string> arguments = ParseArguments(argc, argv);
+        string address = GetArgument(arguments, "connect"s, ""s);
+        const string transport = GetArgument(arguments, "transport"s, "unix"s);
+        if (transport != "unix"s && transport != "tcp"s) {
+            throw invalid_argument("Unknown transport "s + transport);
+        }
+        const int document_count = stoi(GetArgument(arguments, "documents"s, "100000"s));
+        const size_t batch_size = stoul(GetArgument(arguments, "batch"s, "256"s));
+        const size_t connection_count = stoul(GetArgument(arguments, "connections"s, "4"s));
+        const size_t pipeline = stoul(GetArgument(arguments, "pipeline"s, "8"s));
+        const auto duration = chrono::milliseconds(static_cast<int64_t>(stod(GetArgument(arguments, "duration"s, "5"s)) * 1000));
+        const string query_log = GetArgument(arguments, "queries"s, ""s);
+        const size_t query_count = stoul(GetArgument(arguments, "query-count"s, "10000"s));
+        const double zipf_exponent = stod(GetArgument(arguments, "zipf"s, "1.0"s));
+        const auto seed = static_cast<uint32_t>(stoul(GetArgument(arguments, "seed"s, "42"s)));
+        CheckNoArgumentsLeft(arguments);
+        if (connection_count == 0 || pipeline == 0) {
+            throw invalid_argument("Connections and pipeline depth must be positive"s);
+        }
+
+        mt19937 generator(seed);
+        const vector<string> dictionary = GenerateDictionary(generator, 20'000, 10);
+        const vector<string> queries = query_log.empty()
+                                           ? GenerateZipfianQueries(generator, dictionary, query_count, zipf_exponent, 3)
+                                           : ReadQueryLog(query_log);
+        if (queries.empty()) {
+            throw invalid_argument("Query set is empty"s);
+        }
+
+        // без --connect сервер поднимается здесь же, на отдельном потоке
+        SearchServer search_server("and in at with"s);
+        unique_ptr<NetworkServer> network_server;
+        thread server_thread;
+        if (address.empty()) {
+            {
+                LOG_DURATION("indexing"sv);
+                FillBenchmarkServer(search_server, generator, dictionary, document_count, 20);
+            }
+            NetworkServerOptions options;
+            options.max_batch_size = batch_size;
+            if (transport == "tcp"s) {
+                options.tcp_port = 0;
+            } else {
+                options.unix_socket_path = "/tmp/network_benchmark."s + to_string(getpid()) + ".sock"s;
+            }
+            network_server = make_unique<NetworkServer>(search_server, options);
+            address = transport == "tcp"s ? "tcp:127.0.0.1:"s + to_string(network_server->GetTcpPort())
+                                          : "unix:"s + options.unix_socket_path;
+            server_thread = thread([&network_server] {
+                network_server->Run();
+            });
+        }
+        cerr << address << ", "s << connection_count << " connections x "s << pipeline << " requests in flight"s << endl;
+
+        vector<ConnectionStats> stats(connection_count);
+        vector<thread> threads;
+        const Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < connection_count; ++i) {
+            threads.emplace_back([&, i] {
+                try {
+                    RunConnection(address, queries, i * queries.size() / connection_count, pipeline, start + duration, stats[i]);
+                } catch (const exception& e) {
+                    cerr << "connection "s << i << ": "s << e.what() << endl;
+                    ++stats[i].errors;
+                }
+            });
+        }
+        for (thread& thread : threads) {
+            thread.join();
+        }
+        const chrono::duration<double> elapsed = Clock::now() - start;
+
+        OperationReport report;
+        report.name = "search"s;
+        for (const ConnectionStats& connection_stats : stats) {
+            report.latencies.Merge(connection_stats.latencies);
+            report.errors += connection_stats.errors;
+        }
+        report.count = report.latencies.GetCount();
+        report.throughput = report.count / elapsed.count();
+        PrintLoadReport(cout, {report});
+
+        if (network_server) {
+            network_server->Stop();
+            server_thread.join();
+            const NetworkServerStats server_stats = network_server->GetStats();
+            cout << "server: "s << server_stats.batches << " batches, average size "s << fixed << setprecision(1)
+                 << server_stats.GetAverageBatchSize() << defaultfloat
+                 << ", max "s << server_stats.max_batch_size << ", backpressure pauses "s
+                 << server_stats.backpressure_pauses << endl;
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl << USAGE;
+        return 1;
+    }
+    return 0;
+}
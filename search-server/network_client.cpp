@@ -0,0 +1,193 @@
+#include "network_client.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t READ_CHUNK_SIZE = 64 << 10;
+
+[[noreturn]] void ThrowSystemError(const string& what) {
+    throw system_error(errno, generic_category(), what);
+}
+
+}  // namespace
+
+SearchClient::SearchClient(int fd)
+    : fd_(fd) {
+}
+
+SearchClient::SearchClient(SearchClient&& other) noexcept
+    : fd_(exchange(other.fd_, -1))
+    , next_request_id_(other.next_request_id_)
+    , output_(move(other.output_))
+    , input_(move(other.input_)) {
+}
+
+SearchClient& SearchClient::operator=(SearchClient&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = exchange(other.fd_, -1);
+        next_request_id_ = other.next_request_id_;
+        output_ = move(other.output_);
+        input_ = move(other.input_);
+    }
+    return *this;
+}
+
+SearchClient::~SearchClient() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+SearchClient SearchClient::ConnectTcp(const string& host, uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        throw invalid_argument("Invalid IPv4 address "s + host);
+    }
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        ThrowSystemError("socket"s);
+    }
+    SearchClient client(fd);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("connect "s + host + ":"s + to_string(port));
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return client;
+}
+
+SearchClient SearchClient::ConnectUnix(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument("Unix socket path is too long: "s + path);
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        ThrowSystemError("socket"s);
+    }
+    SearchClient client(fd);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("connect "s + path);
+    }
+    return client;
+}
+
+SearchClient SearchClient::Connect(const string& address) {
+    if (address.substr(0, 5) == "unix:"s) {
+        return ConnectUnix(address.substr(5));
+    }
+    const size_t colon = address.rfind(':');
+    if (address.substr(0, 4) != "tcp:"s || colon <= 4) {
+        throw invalid_argument("Address must be tcp:HOST:PORT or unix:PATH, got "s + address);
+    }
+    return ConnectTcp(address.substr(4, colon - 4), static_cast<uint16_t>(stoul(address.substr(colon + 1))));
+}
+
+uint32_t SearchClient::Send(NetworkRequest request) {
+    request.request_id = next_request_id_++;
+    output_.clear();
+    AppendRequestFrame(output_, request);
+    WriteAll(output_);
+    return request.request_id;
+}
+
+NetworkResponse SearchClient::Receive() {
+    while (true) {
+        const size_t frame_size = GetFrameSize(input_);
+        if (frame_size != 0) {
+            NetworkResponse response = DecodeResponse(string_view(input_).substr(0, frame_size));
+            input_.erase(0, frame_size);
+            return response;
+        }
+        const size_t size = input_.size();
+        input_.resize(size + READ_CHUNK_SIZE);
+        const ssize_t read_size = recv(fd_, input_.data() + size, READ_CHUNK_SIZE, 0);
+        input_.resize(size + max<ssize_t>(read_size, 0));
+        if (read_size == 0) {
+            throw runtime_error("Connection closed by server"s);
+        }
+        if (read_size < 0 && errno != EINTR) {
+            ThrowSystemError("recv"s);
+        }
+    }
+}
+
+void SearchClient::WriteAll(string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+NetworkResponse SearchClient::Call(NetworkRequest request) {
+    const uint32_t request_id = Send(move(request));
+    NetworkResponse response = Receive();
+    if (response.request_id != request_id) {
+        throw runtime_error("Response to another request: call Receive for every Send first"s);
+    }
+    if (response.status == ResponseStatus::ERROR) {
+        throw runtime_error(response.error);
+    }
+    return response;
+}
+
+vector<Document> SearchClient::Search(string_view query, DocumentStatus status) {
+    NetworkRequest request;
+    request.type = RequestType::SEARCH;
+    request.text = string(query);
+    request.status = status;
+    return Call(move(request)).documents;
+}
+
+tuple<vector<string>, DocumentStatus> SearchClient::Match(string_view query, int document_id) {
+    NetworkRequest request;
+    request.type = RequestType::MATCH;
+    request.text = string(query);
+    request.document_id = document_id;
+    NetworkResponse response = Call(move(request));
+    return {move(response.matched_words), response.document_status};
+}
+
+void SearchClient::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    NetworkRequest request;
+    request.type = RequestType::ADD;
+    request.text = string(document);
+    request.document_id = document_id;
+    request.status = status;
+    request.ratings = ratings;
+    Call(move(request));
+}
+
+void SearchClient::RemoveDocument(int document_id) {
+    NetworkRequest request;
+    request.type = RequestType::REMOVE;
+    request.document_id = document_id;
+    Call(move(request));
+}
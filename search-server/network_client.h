@@ -0,0 +1,44 @@
+#pragma once
+
+#include "network_protocol.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Блокирующий клиент NetworkServer. Запросы можно отправлять конвейером: Send не ждёт
+// ответа, Receive возвращает ответы в порядке отправки. Методы Search, Match, AddDocument
+// и RemoveDocument ждут свой ответ и бросают runtime_error с текстом ошибки сервера.
+class SearchClient {
+public:
+    static SearchClient ConnectTcp(const std::string& host, uint16_t port);
+    static SearchClient ConnectUnix(const std::string& path);
+    // "tcp:HOST:PORT" или "unix:PATH"
+    static SearchClient Connect(const std::string& address);
+
+    SearchClient(SearchClient&& other) noexcept;
+    SearchClient& operator=(SearchClient&& other) noexcept;
+    ~SearchClient();
+
+    std::vector<Document> Search(std::string_view query, DocumentStatus status = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> Match(std::string_view query, int document_id);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    // Назначает запросу request_id и возвращает его
+    uint32_t Send(NetworkRequest request);
+    NetworkResponse Receive();
+
+private:
+    explicit SearchClient(int fd);
+
+    NetworkResponse Call(NetworkRequest request);
+    void WriteAll(std::string_view data);
+
+    int fd_ = -1;
+    uint32_t next_request_id_ = 1;
+    std::string output_;
+    std::string input_;
+};
@@ -0,0 +1,304 @@
+#include "network_protocol.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+class FrameWriter {
+public:
+    // резервирует место под длину, которая записывается в деструкторе
+    explicit FrameWriter(string& out)
+        : out_(out)
+        , start_(out.size()) {
+        WriteUint32(0);
+    }
+
+    ~FrameWriter() {
+        const auto length = static_cast<uint32_t>(out_.size() - start_ - FRAME_HEADER_SIZE);
+        for (size_t i = 0; i < sizeof(length); ++i) {
+            out_[start_ + i] = static_cast<char>(length >> (8 * i));
+        }
+    }
+
+    void WriteUint8(uint8_t value) {
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void WriteUint32(uint32_t value) {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            out_.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void WriteInt32(int value) {
+        WriteUint32(static_cast<uint32_t>(value));
+    }
+
+    void WriteDouble(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        WriteUint32(static_cast<uint32_t>(bits));
+        WriteUint32(static_cast<uint32_t>(bits >> 32));
+    }
+
+    void WriteString(string_view value) {
+        WriteUint32(static_cast<uint32_t>(value.size()));
+        out_.append(value);
+    }
+
+    void WriteHeader(RequestType type, uint32_t request_id) {
+        WriteUint8(static_cast<uint8_t>(type));
+        WriteUint32(request_id);
+    }
+
+private:
+    string& out_;
+    size_t start_;
+};
+
+class FrameReader {
+public:
+    explicit FrameReader(string_view frame)
+        : data_(frame.substr(min(frame.size(), FRAME_HEADER_SIZE))) {
+        // предел длины проверен при выделении кадра из потока (GetFrameSize с пределом
+        // соединения), здесь кадр только должен совпасть с длиной из заголовка
+        if (GetFrameSize(frame, frame.size()) != frame.size()) {
+            throw invalid_argument("Incomplete frame"s);
+        }
+    }
+
+    uint8_t ReadUint8() {
+        return static_cast<uint8_t>(Take(1)[0]);
+    }
+
+    uint32_t ReadUint32() {
+        const string_view bytes = Take(sizeof(uint32_t));
+        uint32_t value = 0;
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            value |= uint32_t{static_cast<uint8_t>(bytes[i])} << (8 * i);
+        }
+        return value;
+    }
+
+    int ReadInt32() {
+        return static_cast<int>(ReadUint32());
+    }
+
+    double ReadDouble() {
+        const uint64_t low = ReadUint32();
+        const uint64_t bits = low | uint64_t{ReadUint32()} << 32;
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    string ReadString() {
+        const uint32_t length = ReadUint32();
+        return string(Take(length));
+    }
+
+    // длина массива, каждый элемент которого занимает не меньше element_size байт
+    size_t ReadCount(size_t element_size) {
+        const uint32_t count = ReadUint32();
+        if (count > (data_.size() - pos_) / element_size) {
+            throw invalid_argument("Frame is truncated"s);
+        }
+        return count;
+    }
+
+    RequestType ReadType() {
+        const uint8_t type = ReadUint8();
+        if (type < static_cast<uint8_t>(RequestType::SEARCH) || type > static_cast<uint8_t>(RequestType::REMOVE)) {
+            throw invalid_argument("Unknown request type "s + to_string(type));
+        }
+        return static_cast<RequestType>(type);
+    }
+
+    DocumentStatus ReadStatus() {
+        const uint8_t status = ReadUint8();
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            throw invalid_argument("Unknown document status "s + to_string(status));
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    void ExpectEnd() const {
+        if (pos_ != data_.size()) {
+            throw invalid_argument("Unexpected data at the end of frame"s);
+        }
+    }
+
+private:
+    string_view Take(size_t size) {
+        if (size > data_.size() - pos_) {
+            throw invalid_argument("Frame is truncated"s);
+        }
+        const string_view bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return bytes;
+    }
+
+    string_view data_;
+    size_t pos_ = 0;
+};
+
+const size_t ENCODED_DOCUMENT_SIZE = 16;
+
+void WriteDocuments(FrameWriter& writer, const vector<Document>& documents) {
+    writer.WriteUint32(static_cast<uint32_t>(documents.size()));
+    for (const Document& document : documents) {
+        writer.WriteInt32(document.id);
+        writer.WriteDouble(document.relevance);
+        writer.WriteInt32(document.rating);
+    }
+}
+
+template <typename Words>
+void WriteMatchResult(FrameWriter& writer, const Words& words, DocumentStatus status) {
+    writer.WriteUint32(static_cast<uint32_t>(words.size()));
+    for (const auto& word : words) {
+        writer.WriteString(word);
+    }
+    writer.WriteUint8(static_cast<uint8_t>(status));
+}
+
+}  // namespace
+
+size_t GetFrameSize(string_view buffer, size_t max_frame_size) {
+    if (buffer.size() < FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    size_t length = 0;
+    for (size_t i = 0; i < FRAME_HEADER_SIZE; ++i) {
+        length |= size_t{static_cast<uint8_t>(buffer[i])} << (8 * i);
+    }
+    if (length > max_frame_size) {
+        throw invalid_argument("Frame of "s + to_string(length) + " bytes is too large"s);
+    }
+    return buffer.size() - FRAME_HEADER_SIZE >= length ? FRAME_HEADER_SIZE + length : 0;
+}
+
+void AppendRequestFrame(string& out, const NetworkRequest& request) {
+    FrameWriter writer(out);
+    writer.WriteHeader(request.type, request.request_id);
+    switch (request.type) {
+        case RequestType::SEARCH:
+            writer.WriteString(request.text);
+            writer.WriteUint8(static_cast<uint8_t>(request.status));
+            break;
+        case RequestType::MATCH:
+            writer.WriteString(request.text);
+            writer.WriteInt32(request.document_id);
+            break;
+        case RequestType::ADD:
+            writer.WriteInt32(request.document_id);
+            writer.WriteUint8(static_cast<uint8_t>(request.status));
+            writer.WriteUint32(static_cast<uint32_t>(request.ratings.size()));
+            for (const int rating : request.ratings) {
+                writer.WriteInt32(rating);
+            }
+            writer.WriteString(request.text);
+            break;
+        case RequestType::REMOVE:
+            writer.WriteInt32(request.document_id);
+            break;
+    }
+}
+
+void AppendResponseFrame(string& out, const NetworkResponse& response) {
+    FrameWriter writer(out);
+    writer.WriteHeader(response.type, response.request_id);
+    writer.WriteUint8(static_cast<uint8_t>(response.status));
+    if (response.status == ResponseStatus::ERROR) {
+        writer.WriteString(response.error);
+    } else if (response.type == RequestType::SEARCH) {
+        WriteDocuments(writer, response.documents);
+    } else if (response.type == RequestType::MATCH) {
+        WriteMatchResult(writer, response.matched_words, response.document_status);
+    }
+}
+
+void AppendSearchResponseFrame(string& out, uint32_t request_id, const vector<Document>& documents) {
+    FrameWriter writer(out);
+    writer.WriteHeader(RequestType::SEARCH, request_id);
+    writer.WriteUint8(static_cast<uint8_t>(ResponseStatus::OK));
+    WriteDocuments(writer, documents);
+}
+
+void AppendMatchResponseFrame(string& out, uint32_t request_id, const vector<string_view>& words, DocumentStatus status) {
+    FrameWriter writer(out);
+    writer.WriteHeader(RequestType::MATCH, request_id);
+    writer.WriteUint8(static_cast<uint8_t>(ResponseStatus::OK));
+    WriteMatchResult(writer, words, status);
+}
+
+void AppendErrorFrame(string& out, RequestType type, uint32_t request_id, string_view error) {
+    FrameWriter writer(out);
+    writer.WriteHeader(type, request_id);
+    writer.WriteUint8(static_cast<uint8_t>(ResponseStatus::ERROR));
+    writer.WriteString(error);
+}
+
+NetworkRequest DecodeRequest(string_view frame) {
+    FrameReader reader(frame);
+    NetworkRequest request;
+    request.type = reader.ReadType();
+    request.request_id = reader.ReadUint32();
+    switch (request.type) {
+        case RequestType::SEARCH:
+            request.text = reader.ReadString();
+            request.status = reader.ReadStatus();
+            break;
+        case RequestType::MATCH:
+            request.text = reader.ReadString();
+            request.document_id = reader.ReadInt32();
+            break;
+        case RequestType::ADD:
+            request.document_id = reader.ReadInt32();
+            request.status = reader.ReadStatus();
+            request.ratings.resize(reader.ReadCount(sizeof(int32_t)));
+            for (int& rating : request.ratings) {
+                rating = reader.ReadInt32();
+            }
+            request.text = reader.ReadString();
+            break;
+        case RequestType::REMOVE:
+            request.document_id = reader.ReadInt32();
+            break;
+    }
+    reader.ExpectEnd();
+    return request;
+}
+
+NetworkResponse DecodeResponse(string_view frame) {
+    FrameReader reader(frame);
+    NetworkResponse response;
+    response.type = reader.ReadType();
+    response.request_id = reader.ReadUint32();
+    const uint8_t status = reader.ReadUint8();
+    if (status > static_cast<uint8_t>(ResponseStatus::ERROR)) {
+        throw invalid_argument("Unknown response status "s + to_string(status));
+    }
+    response.status = static_cast<ResponseStatus>(status);
+    if (response.status == ResponseStatus::ERROR) {
+        response.error = reader.ReadString();
+    } else if (response.type == RequestType::SEARCH) {
+        response.documents.resize(reader.ReadCount(ENCODED_DOCUMENT_SIZE));
+        for (Document& document : response.documents) {
+            document.id = reader.ReadInt32();
+            document.relevance = reader.ReadDouble();
+            document.rating = reader.ReadInt32();
+        }
+    } else if (response.type == RequestType::MATCH) {
+        response.matched_words.resize(reader.ReadCount(sizeof(uint32_t)));
+        for (string& word : response.matched_words) {
+            word = reader.ReadString();
+        }
+        response.document_status = reader.ReadStatus();
+    }
+    reader.ExpectEnd();
+    return response;
+}
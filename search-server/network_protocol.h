@@ -0,0 +1,70 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Двоичный протокол сетевого фронтенда. Кадр - длина тела (uint32) и тело; все числа
+// little-endian, строки - длина (uint32) и байты. Тело запроса: тип (uint8), id запроса
+// (uint32) и аргументы типа, тело ответа: тип и id запроса, статус (uint8) и результат
+// или текст ошибки. Ответы на запросы одного соединения приходят в порядке запросов.
+enum class RequestType : uint8_t {
+    // запрос (строка), статус документов (uint8) -> документы: число, затем id, релевантность (double), рейтинг
+    SEARCH = 1,
+    // запрос, id документа (int32) -> найденные слова (число и строки), статус документа
+    MATCH = 2,
+    // id документа, статус, рейтинги (число и int32), текст -> пустой ответ
+    ADD = 3,
+    // id документа -> пустой ответ
+    REMOVE = 4,
+};
+
+enum class ResponseStatus : uint8_t {
+    OK = 0,
+    // вместо результата - текст исключения, которое бросил сервер
+    ERROR = 1,
+};
+
+struct NetworkRequest {
+    RequestType type = RequestType::SEARCH;
+    uint32_t request_id = 0;
+    // запрос для SEARCH и MATCH, текст документа для ADD
+    std::string text;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+struct NetworkResponse {
+    RequestType type = RequestType::SEARCH;
+    uint32_t request_id = 0;
+    ResponseStatus status = ResponseStatus::OK;
+    std::string error;
+    std::vector<Document> documents;
+    std::vector<std::string> matched_words;
+    DocumentStatus document_status = DocumentStatus::ACTUAL;
+};
+
+const size_t FRAME_HEADER_SIZE = sizeof(uint32_t);
+const size_t MAX_FRAME_SIZE = 16 << 20;
+
+// Размер первого кадра в buffer вместе с заголовком или 0, если кадр ещё не пришёл целиком.
+// Бросает invalid_argument, если кадр длиннее max_frame_size; функции разбора бросают его же,
+// если кадр повреждён, а длину не ограничивают.
+size_t GetFrameSize(std::string_view buffer, size_t max_frame_size = MAX_FRAME_SIZE);
+
+void AppendRequestFrame(std::string& out, const NetworkRequest& request);
+void AppendResponseFrame(std::string& out, const NetworkResponse& response);
+// Ответ SEARCH кодируется прямо из результата поиска, без копии в NetworkResponse
+void AppendSearchResponseFrame(std::string& out, uint32_t request_id, const std::vector<Document>& documents);
+void AppendMatchResponseFrame(std::string& out, uint32_t request_id, const std::vector<std::string_view>& words,
+                              DocumentStatus status);
+void AppendErrorFrame(std::string& out, RequestType type, uint32_t request_id, std::string_view error);
+
+// frame - кадр целиком, вместе с заголовком, как его выделил GetFrameSize
+NetworkRequest DecodeRequest(std::string_view frame);
+NetworkResponse DecodeResponse(std::string_view frame);
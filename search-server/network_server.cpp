@@ -0,0 +1,543 @@
+#include "network_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <numeric>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// data.u64 событий epoll: служебные дескрипторы, затем id соединений
+const uint64_t WAKEUP_KEY = 0;
+const uint64_t TCP_LISTENER_KEY = 1;
+const uint64_t UNIX_LISTENER_KEY = 2;
+const uint64_t FIRST_CONNECTION_ID = 3;
+
+const size_t READ_CHUNK_SIZE = 64 << 10;
+const int MAX_EPOLL_EVENTS = 256;
+
+[[noreturn]] void ThrowSystemError(const string& what) {
+    throw system_error(errno, generic_category(), what);
+}
+
+void AddToEpoll(int epoll_fd, int fd, uint32_t events, uint64_t key) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = key;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        ThrowSystemError("epoll_ctl"s);
+    }
+}
+
+bool IsWriteRequest(RequestType type) {
+    return type == RequestType::ADD || type == RequestType::REMOVE;
+}
+
+}  // namespace
+
+NetworkServer::NetworkServer(SearchServer& search_server, NetworkServerOptions options)
+    : search_server_(search_server)
+    , options_(move(options))
+    , next_connection_id_(FIRST_CONNECTION_ID) {
+    if (options_.tcp_port < 0 && options_.unix_socket_path.empty()) {
+        throw invalid_argument("Neither TCP port nor Unix socket path is set"s);
+    }
+    if (options_.max_batch_size == 0 || options_.max_pending_requests == 0) {
+        throw invalid_argument("Batch size and pending request limit must be positive"s);
+    }
+    try {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            ThrowSystemError("epoll_create1"s);
+        }
+        wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_fd_ < 0) {
+            ThrowSystemError("eventfd"s);
+        }
+        AddToEpoll(epoll_fd_, wakeup_fd_, EPOLLIN, WAKEUP_KEY);
+        if (options_.tcp_port >= 0) {
+            OpenTcpListener();
+        }
+        if (!options_.unix_socket_path.empty()) {
+            OpenUnixListener();
+        }
+    } catch (...) {
+        CloseDescriptors();
+        throw;
+    }
+    executor_ = thread([this] {
+        ExecutorLoop();
+    });
+}
+
+NetworkServer::~NetworkServer() {
+    {
+        lock_guard guard(mutex_);
+        executor_stopping_ = true;
+    }
+    has_requests_.notify_one();
+    executor_.join();
+    for (const auto& [id, connection] : connections_) {
+        close(connection.fd);
+    }
+    CloseDescriptors();
+}
+
+void NetworkServer::OpenTcpListener() {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options_.tcp_port));
+    if (inet_pton(AF_INET, options_.tcp_host.c_str(), &address.sin_addr) != 1) {
+        throw invalid_argument("Invalid IPv4 address "s + options_.tcp_host);
+    }
+    tcp_listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (tcp_listen_fd_ < 0) {
+        ThrowSystemError("socket"s);
+    }
+    const int enable = 1;
+    setsockopt(tcp_listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(tcp_listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("bind "s + options_.tcp_host + ":"s + to_string(options_.tcp_port));
+    }
+    if (listen(tcp_listen_fd_, SOMAXCONN) < 0) {
+        ThrowSystemError("listen"s);
+    }
+    socklen_t length = sizeof(address);
+    if (getsockname(tcp_listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+        ThrowSystemError("getsockname"s);
+    }
+    tcp_port_ = ntohs(address.sin_port);
+    AddToEpoll(epoll_fd_, tcp_listen_fd_, EPOLLIN, TCP_LISTENER_KEY);
+}
+
+void NetworkServer::OpenUnixListener() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options_.unix_socket_path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument("Unix socket path is too long: "s + options_.unix_socket_path);
+    }
+    memcpy(address.sun_path, options_.unix_socket_path.c_str(), options_.unix_socket_path.size() + 1);
+    // сокет, оставшийся от предыдущего запуска
+    unlink(options_.unix_socket_path.c_str());
+    unix_listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (unix_listen_fd_ < 0) {
+        ThrowSystemError("socket"s);
+    }
+    if (bind(unix_listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("bind "s + options_.unix_socket_path);
+    }
+    if (listen(unix_listen_fd_, SOMAXCONN) < 0) {
+        ThrowSystemError("listen"s);
+    }
+    AddToEpoll(epoll_fd_, unix_listen_fd_, EPOLLIN, UNIX_LISTENER_KEY);
+}
+
+void NetworkServer::CloseDescriptors() {
+    for (const int fd : {tcp_listen_fd_, unix_listen_fd_, wakeup_fd_, epoll_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (unix_listen_fd_ >= 0) {
+        unlink(options_.unix_socket_path.c_str());
+    }
+    tcp_listen_fd_ = unix_listen_fd_ = wakeup_fd_ = epoll_fd_ = -1;
+}
+
+void NetworkServer::Stop() {
+    stopping_.store(true);
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+}
+
+NetworkServerStats NetworkServer::GetStats() const {
+    NetworkServerStats stats;
+    stats.connections = connection_count_.load();
+    stats.requests = request_count_.load();
+    stats.batches = batch_count_.load();
+    stats.max_batch_size = max_batch_size_.load();
+    stats.backpressure_pauses = backpressure_pauses_.load();
+    return stats;
+}
+
+void NetworkServer::Run() {
+    vector<epoll_event> events(MAX_EPOLL_EVENTS);
+    while (!stopping_.load()) {
+        const int count = epoll_wait(epoll_fd_, events.data(), MAX_EPOLL_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t key = events[i].data.u64;
+            if (key == WAKEUP_KEY) {
+                uint64_t value;
+                [[maybe_unused]] const ssize_t read_size = read(wakeup_fd_, &value, sizeof(value));
+                DeliverResponses();
+            } else if (key == TCP_LISTENER_KEY) {
+                AcceptConnections(tcp_listen_fd_, true);
+            } else if (key == UNIX_LISTENER_KEY) {
+                AcceptConnections(unix_listen_fd_, false);
+            } else {
+                HandleConnectionEvent(key, events[i].events);
+            }
+        }
+        UpdateBackpressure();
+        SubmitRequests();
+    }
+}
+
+void NetworkServer::AcceptConnections(int listen_fd, bool is_tcp) {
+    while (true) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN - очередь пуста; при нехватке дескрипторов соединения ждут в очереди
+            return;
+        }
+        if (is_tcp) {
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        const uint64_t connection_id = next_connection_id_++;
+        Connection& connection = connections_[connection_id];
+        connection.fd = fd;
+        connection.events = reading_paused_ ? 0u : uint32_t{EPOLLIN};
+        AddToEpoll(epoll_fd_, fd, connection.events, connection_id);
+        ++connection_count_;
+    }
+}
+
+void NetworkServer::HandleConnectionEvent(uint64_t connection_id, uint32_t events) {
+    const auto it = connections_.find(connection_id);
+    if (it == connections_.end()) {
+        return;
+    }
+    Connection& connection = it->second;
+    bool alive = (events & EPOLLERR) == 0;
+    if (alive && (events & EPOLLIN)) {
+        ReadRequests(connection);
+        alive = connection.fd >= 0 && ParseRequests(connection_id, connection);
+    } else if (alive && (events & EPOLLHUP)) {
+        // обе стороны закрыты, ответы отправить некуда
+        alive = false;
+    }
+    if (alive && (events & EPOLLOUT)) {
+        alive = FlushOutput(connection);
+    }
+    UpdateConnection(connection_id, alive);
+}
+
+void NetworkServer::ReadRequests(Connection& connection) {
+    size_t size = connection.input.size();
+    connection.input.resize(size + READ_CHUNK_SIZE);
+    const ssize_t read_size = recv(connection.fd, connection.input.data() + size, READ_CHUNK_SIZE, 0);
+    if (read_size > 0) {
+        size += static_cast<size_t>(read_size);
+    } else if (read_size == 0) {
+        connection.input_closed = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        close(connection.fd);
+        connection.fd = -1;
+    }
+    connection.input.resize(size);
+}
+
+bool NetworkServer::ParseRequests(uint64_t connection_id, Connection& connection) {
+    size_t offset = 0;
+    try {
+        while (in_flight_ < options_.max_pending_requests) {
+            const string_view rest = string_view(connection.input).substr(offset);
+            const size_t frame_size = GetFrameSize(rest, options_.max_frame_size);
+            if (frame_size == 0) {
+                break;
+            }
+            incoming_.push_back({connection_id, DecodeRequest(rest.substr(0, frame_size))});
+            offset += frame_size;
+            ++connection.pending_requests;
+            ++in_flight_;
+        }
+    } catch (const invalid_argument&) {
+        // после испорченного кадра границы следующих неизвестны
+        return false;
+    }
+    connection.input.erase(0, offset);
+    return true;
+}
+
+bool NetworkServer::FlushOutput(Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t written = send(connection.fd, connection.output.data() + connection.output_offset,
+                                     connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.output_offset += static_cast<size_t>(written);
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+    return true;
+}
+
+void NetworkServer::UpdateConnection(uint64_t connection_id, bool alive) {
+    Connection& connection = connections_.at(connection_id);
+    const bool has_output = connection.output_offset < connection.output.size();
+    if (!alive || connection.fd < 0 || (connection.input_closed && connection.pending_requests == 0 && !has_output)) {
+        CloseConnection(connection_id);
+        return;
+    }
+    uint32_t events = has_output ? uint32_t{EPOLLOUT} : 0u;
+    if (!reading_paused_ && !connection.input_closed
+        && connection.output.size() - connection.output_offset < options_.max_output_buffer) {
+        events |= EPOLLIN;
+    }
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = connection_id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) < 0) {
+            ThrowSystemError("epoll_ctl"s);
+        }
+        connection.events = events;
+    }
+}
+
+void NetworkServer::CloseConnection(uint64_t connection_id) {
+    const auto it = connections_.find(connection_id);
+    if (it->second.fd >= 0) {
+        close(it->second.fd);
+    }
+    // ответы на запросы, которые ещё у исполнителя, будут отброшены в DeliverResponses
+    connections_.erase(it);
+}
+
+void NetworkServer::DeliverResponses() {
+    vector<Response> responses;
+    {
+        lock_guard guard(mutex_);
+        responses.swap(completed_);
+    }
+    vector<uint64_t> updated;
+    for (Response& response : responses) {
+        --in_flight_;
+        const auto it = connections_.find(response.connection_id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& connection = it->second;
+        connection.output += response.frame;
+        --connection.pending_requests;
+        if (updated.empty() || updated.back() != response.connection_id) {
+            updated.push_back(response.connection_id);
+        }
+    }
+    sort(updated.begin(), updated.end());
+    updated.erase(unique(updated.begin(), updated.end()), updated.end());
+    for (const uint64_t connection_id : updated) {
+        UpdateConnection(connection_id, FlushOutput(connections_.at(connection_id)));
+    }
+}
+
+void NetworkServer::UpdateBackpressure() {
+    const bool paused = in_flight_ >= options_.max_pending_requests;
+    if (paused == reading_paused_) {
+        return;
+    }
+    if (paused) {
+        ++backpressure_pauses_;
+    } else {
+        // кадры, прочитанные до паузы, но не разобранные
+        for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+            if (!ParseRequests(it->first, it->second)) {
+                close(it->second.fd);
+                it->second.fd = -1;
+            }
+        }
+    }
+    reading_paused_ = in_flight_ >= options_.max_pending_requests;
+    vector<uint64_t> connection_ids;
+    connection_ids.reserve(connections_.size());
+    for (const auto& [id, connection] : connections_) {
+        connection_ids.push_back(id);
+    }
+    for (const uint64_t connection_id : connection_ids) {
+        UpdateConnection(connection_id, true);
+    }
+}
+
+void NetworkServer::SubmitRequests() {
+    if (incoming_.empty()) {
+        return;
+    }
+    {
+        lock_guard guard(mutex_);
+        move(incoming_.begin(), incoming_.end(), back_inserter(pending_));
+    }
+    incoming_.clear();
+    has_requests_.notify_one();
+}
+
+void NetworkServer::ExecutorLoop() {
+    vector<PendingRequest> batch;
+    vector<Response> responses;
+    while (true) {
+        {
+            unique_lock lock(mutex_);
+            has_requests_.wait(lock, [this] {
+                return executor_stopping_ || !pending_.empty();
+            });
+            if (executor_stopping_) {
+                return;
+            }
+            // в пакет идёт всё, что накопилось, пока выполнялся предыдущий
+            const size_t batch_size = min(pending_.size(), options_.max_batch_size);
+            batch.assign(make_move_iterator(pending_.begin()), make_move_iterator(pending_.begin() + batch_size));
+            pending_.erase(pending_.begin(), pending_.begin() + batch_size);
+        }
+        ExecuteBatch(batch, responses);
+        {
+            lock_guard guard(mutex_);
+            move(responses.begin(), responses.end(), back_inserter(completed_));
+        }
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+
+        request_count_ += batch.size();
+        ++batch_count_;
+        if (batch.size() > max_batch_size_.load()) {
+            max_batch_size_.store(batch.size());
+        }
+    }
+}
+
+template <typename Function>
+void NetworkServer::ForEachInBatch(size_t begin, size_t end, Function function) const {
+    if (!options_.parallel_batches || end - begin == 1) {
+        for (size_t i = begin; i < end; ++i) {
+            function(i);
+        }
+        return;
+    }
+    vector<size_t> indices(end - begin);
+    iota(indices.begin(), indices.end(), begin);
+    for_each(execution::par, indices.begin(), indices.end(), function);
+}
+
+// Пакет делится на группы подряд идущих запросов одного вида: поиски и сопоставления только
+// читают индекс и выполняются параллельно, тексты добавляемых документов разбираются на слова
+// параллельно, а в индекс добавляются по порядку, подряд идущие удаления чистят списки один раз
+void NetworkServer::ExecuteBatch(vector<PendingRequest>& batch, vector<Response>& responses) {
+    responses.assign(batch.size(), Response{});
+    for (size_t i = 0; i < batch.size(); ++i) {
+        responses[i].connection_id = batch[i].connection_id;
+    }
+    const auto fail = [&batch, &responses](size_t i, const exception& e) {
+        responses[i].frame.clear();
+        AppendErrorFrame(responses[i].frame, batch[i].request.type, batch[i].request.request_id, e.what());
+    };
+    const auto succeed = [&batch, &responses](size_t i) {
+        NetworkResponse response;
+        response.type = batch[i].request.type;
+        response.request_id = batch[i].request.request_id;
+        AppendResponseFrame(responses[i].frame, response);
+    };
+
+    bool has_writes = false;
+    for (size_t begin = 0; begin < batch.size();) {
+        const RequestType type = batch[begin].request.type;
+        size_t end = begin + 1;
+        while (end < batch.size()
+               && (IsWriteRequest(type) ? batch[end].request.type == type : !IsWriteRequest(batch[end].request.type))) {
+            ++end;
+        }
+
+        has_writes = has_writes || IsWriteRequest(type);
+        if (type == RequestType::ADD) {
+            vector<PreparedDocument> prepared(end - begin);
+            // не vector<bool>: элементы заполняются из разных потоков
+            vector<char> is_prepared(end - begin, false);
+            ForEachInBatch(begin, end, [&](size_t i) {
+                const NetworkRequest& request = batch[i].request;
+                try {
+                    prepared[i - begin] = search_server_.PrepareDocument(request.document_id, request.text, request.status,
+                                                                         request.ratings);
+                    is_prepared[i - begin] = true;
+                } catch (const exception& e) {
+                    fail(i, e);
+                }
+            });
+            for (size_t i = begin; i < end; ++i) {
+                if (!is_prepared[i - begin]) {
+                    continue;
+                }
+                try {
+                    search_server_.AddDocument(move(prepared[i - begin]));
+                    succeed(i);
+                } catch (const exception& e) {
+                    fail(i, e);
+                }
+            }
+        } else if (type == RequestType::REMOVE) {
+            vector<int> document_ids;
+            for (size_t i = begin; i < end; ++i) {
+                document_ids.push_back(batch[i].request.document_id);
+            }
+            try {
+                search_server_.RemoveDocuments(document_ids);
+                for (size_t i = begin; i < end; ++i) {
+                    succeed(i);
+                }
+            } catch (const exception& e) {
+                // ошибка журнала: ни одно удаление пакета не выполнено
+                for (size_t i = begin; i < end; ++i) {
+                    fail(i, e);
+                }
+            }
+        } else {
+            ForEachInBatch(begin, end, [&](size_t i) {
+                const NetworkRequest& request = batch[i].request;
+                try {
+                    if (request.type == RequestType::SEARCH) {
+                        AppendSearchResponseFrame(responses[i].frame, request.request_id,
+                                                  search_server_.FindTopDocuments(execution::seq, request.text, request.status));
+                    } else {
+                        const auto [words, status] = search_server_.MatchDocument(execution::seq, request.text, request.document_id);
+                        AppendMatchResponseFrame(responses[i].frame, request.request_id, words, status);
+                    }
+                } catch (const exception& e) {
+                    fail(i, e);
+                }
+            });
+        }
+        begin = end;
+    }
+    // ответы на изменения уходят, только когда изменения на диске: один fdatasync на пакет
+    if (has_writes) {
+        try {
+            search_server_.SyncWriteAheadLog();
+        } catch (const exception& e) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (IsWriteRequest(batch[i].request.type)) {
+                    fail(i, e);
+                }
+            }
+        }
+    }
+}
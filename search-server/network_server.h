@@ -0,0 +1,148 @@
+#pragma once
+
+#include "network_protocol.h"
+#include "search_server.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct NetworkServerOptions {
+    // адрес IPv4 и порт TCP: -1 - не слушать TCP, 0 - любой свободный порт (см. GetTcpPort)
+    std::string tcp_host = "127.0.0.1";
+    int tcp_port = -1;
+    // путь сокета Unix, пусто - не слушать
+    std::string unix_socket_path;
+    // запросов в одном пакете исполнителя
+    size_t max_batch_size = 256;
+    // принятые и ещё не отвеченные запросы всех соединений. На пределе сервер перестаёт
+    // читать сокеты, пока исполнитель не догонит, и клиенты упираются в окно TCP.
+    size_t max_pending_requests = 4096;
+    // неотправленные ответы одного соединения, сверх них чтение из соединения приостанавливается
+    size_t max_output_buffer = 4 << 20;
+    size_t max_frame_size = MAX_FRAME_SIZE;
+    // поиски и разбор добавляемых документов внутри пакета выполняются параллельно
+    bool parallel_batches = true;
+};
+
+struct NetworkServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+    uint64_t max_batch_size = 0;
+    // сколько раз чтение сокетов приостанавливалось из-за max_pending_requests
+    uint64_t backpressure_pauses = 0;
+
+    double GetAverageBatchSize() const {
+        return batches > 0 ? static_cast<double>(requests) / batches : 0.0;
+    }
+};
+
+// Сетевой фронтенд поискового сервера (протокол - network_protocol.h). Один поток в Run()
+// обслуживает все соединения через epoll, запросы всех соединений, пришедшие пока исполнитель
+// занят, уходят ему одним пакетом. Исполнитель - единственный поток, работающий с search_server:
+// поиски и сопоставления пакета выполняются параллельно, добавления и удаления - по порядку,
+// так что каждый запрос видит изменения, пришедшие раньше него. Пока сервер существует,
+// search_server нельзя использовать из других потоков.
+class NetworkServer {
+public:
+    // Открывает сокеты, при ошибке бросает system_error
+    NetworkServer(SearchServer& search_server, NetworkServerOptions options);
+    ~NetworkServer();
+
+    NetworkServer(const NetworkServer&) = delete;
+    NetworkServer& operator=(const NetworkServer&) = delete;
+
+    // Цикл обработки соединений, возвращается после Stop()
+    void Run();
+    // Можно вызывать из любого потока и из обработчика сигнала
+    void Stop();
+
+    // Порт, на котором слушает TCP, 0 - TCP не используется
+    uint16_t GetTcpPort() const {
+        return tcp_port_;
+    }
+    NetworkServerStats GetStats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;
+        // запросы соединения у исполнителя
+        size_t pending_requests = 0;
+        // клиент закрыл свою сторону: соединение закрывается после отправки всех ответов
+        bool input_closed = false;
+        uint32_t events = 0;
+    };
+
+    struct PendingRequest {
+        uint64_t connection_id;
+        NetworkRequest request;
+    };
+
+    struct Response {
+        uint64_t connection_id;
+        std::string frame;
+    };
+
+    void OpenTcpListener();
+    void OpenUnixListener();
+    void CloseDescriptors();
+
+    void AcceptConnections(int listen_fd, bool is_tcp);
+    void HandleConnectionEvent(uint64_t connection_id, uint32_t events);
+    void ReadRequests(Connection& connection);
+    // Разбирает пришедшие кадры, пока не достигнут max_pending_requests; false - протокол нарушен
+    bool ParseRequests(uint64_t connection_id, Connection& connection);
+    // false - соединение оборвано
+    bool FlushOutput(Connection& connection);
+    // Закрывает соединение, если оно оборвано или всё отправлено после закрытия клиентом
+    void UpdateConnection(uint64_t connection_id, bool alive);
+    void CloseConnection(uint64_t connection_id);
+    void DeliverResponses();
+    void UpdateBackpressure();
+    void SubmitRequests();
+
+    void ExecutorLoop();
+    void ExecuteBatch(std::vector<PendingRequest>& batch, std::vector<Response>& responses);
+    template <typename Function>
+    void ForEachInBatch(size_t begin, size_t end, Function function) const;
+
+    SearchServer& search_server_;
+    const NetworkServerOptions options_;
+
+    int epoll_fd_ = -1;
+    int wakeup_fd_ = -1;
+    int tcp_listen_fd_ = -1;
+    int unix_listen_fd_ = -1;
+    uint16_t tcp_port_ = 0;
+    std::atomic<bool> stopping_ = false;
+
+    // состояние потока Run()
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t next_connection_id_;
+    std::vector<PendingRequest> incoming_;
+    size_t in_flight_ = 0;
+    bool reading_paused_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable has_requests_;
+    std::deque<PendingRequest> pending_;
+    std::vector<Response> completed_;
+    bool executor_stopping_ = false;
+    std::thread executor_;
+
+    std::atomic<uint64_t> connection_count_ = 0;
+    std::atomic<uint64_t> request_count_ = 0;
+    std::atomic<uint64_t> batch_count_ = 0;
+    std::atomic<uint64_t> max_batch_size_ = 0;
+    std::atomic<uint64_t> backpressure_pauses_ = 0;
+};
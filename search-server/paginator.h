@@ -1,6 +1,8 @@
 #pragma once
 #include <iostream>
+#include <iterator>
 #include <vector>
+#include "document.h"
 
 
 using namespace std;
@@ -73,3 +75,81 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
+
+// Ленивый постраничный обход выдачи по курсору: очередная страница запрашивается
+// у source только при переходе к ней. source вызывается как
+// SearchPage(const SearchCursor& after, size_t page_size), например через SearchServer::FindNextDocuments.
+template <typename PageSource>
+class CursorPaginator {
+public:
+    class PageIterator {
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = IteratorRange<vector<Document>::const_iterator>;
+        using difference_type = ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        // итератор конца обхода
+        PageIterator() = default;
+
+        explicit PageIterator(const CursorPaginator* paginator)
+            : paginator_(paginator) {
+            Fetch(SearchCursor{});
+        }
+
+        value_type operator*() const {
+            return {page_.documents.begin(), page_.documents.end()};
+        }
+
+        PageIterator& operator++() {
+            if (page_.next.IsEnd()) {
+                paginator_ = nullptr;
+            } else {
+                Fetch(page_.next);
+            }
+            return *this;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return paginator_ == other.paginator_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        void Fetch(const SearchCursor& after) {
+            page_ = paginator_->source_(after, paginator_->page_size_);
+            if (page_.documents.empty()) {
+                paginator_ = nullptr;
+            }
+        }
+
+        const CursorPaginator* paginator_ = nullptr;
+        SearchPage page_;
+    };
+
+    CursorPaginator(PageSource source, size_t page_size)
+        : source_(move(source))
+        , page_size_(page_size) {
+    }
+
+    PageIterator begin() const {
+        return PageIterator(this);
+    }
+
+    PageIterator end() const {
+        return {};
+    }
+
+private:
+    PageSource source_;
+    size_t page_size_;
+};
+
+template <typename PageSource>
+auto PaginateByCursor(PageSource source, size_t page_size) {
+    return CursorPaginator<PageSource>(move(source), page_size);
+}
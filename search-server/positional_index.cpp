@@ -0,0 +1,95 @@
+#include "positional_index.h"
+#include "sorted_intersection.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+DocumentPositions::DocumentPositions(const vector<vector<uint32_t>>& positions) {
+    offsets_.reserve(positions.size() + 1);
+    offsets_.push_back(0);
+    for (const auto& term_positions : positions) {
+        uint32_t previous = 0;
+        for (const uint32_t position : term_positions) {
+            uint32_t delta = position - previous;
+            previous = position;
+            while (delta >= 0x80) {
+                data_.push_back(static_cast<uint8_t>(delta | 0x80));
+                delta >>= 7;
+            }
+            data_.push_back(static_cast<uint8_t>(delta));
+        }
+        offsets_.push_back(static_cast<uint32_t>(data_.size()));
+    }
+    data_.shrink_to_fit();
+}
+
+vector<uint32_t> DocumentPositions::GetPositions(size_t term_index) const {
+    vector<uint32_t> positions;
+    uint32_t previous = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (uint32_t i = offsets_[term_index]; i < offsets_[term_index + 1]; ++i) {
+        delta |= static_cast<uint32_t>(data_[i] & 0x7F) << shift;
+        if (data_[i] & 0x80) {
+            shift += 7;
+            continue;
+        }
+        previous += delta;
+        positions.push_back(previous);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
+
+size_t DocumentPositions::GetMemoryUsage() const {
+    return offsets_.capacity() * sizeof(uint32_t) + data_.capacity();
+}
+
+bool ContainsPhrase(const vector<vector<uint32_t>>& phrase_positions) {
+    if (phrase_positions.empty()) {
+        return false;
+    }
+    // кандидаты - позиции первого слова, после которых уже совпали следующие слова
+    vector<uint32_t> candidates = phrase_positions[0];
+    vector<uint32_t> shifted;
+    vector<uint32_t> matched;
+    for (size_t i = 1; i < phrase_positions.size() && !candidates.empty(); ++i) {
+        shifted.clear();
+        for (const uint32_t position : phrase_positions[i]) {
+            if (position >= i) {
+                shifted.push_back(position - static_cast<uint32_t>(i));
+            }
+        }
+        matched.clear();
+        IntersectSorted(candidates.begin(), candidates.end(), shifted.begin(), shifted.end(),
+                        [&matched](uint32_t position) { matched.push_back(position); });
+        swap(candidates, matched);
+    }
+    return !candidates.empty();
+}
+
+uint32_t ComputeMinimalDistance(const vector<vector<uint32_t>>& term_positions) {
+    vector<pair<uint32_t, size_t>> merged;
+    size_t non_empty = 0;
+    for (size_t term = 0; term < term_positions.size(); ++term) {
+        non_empty += !term_positions[term].empty();
+        for (const uint32_t position : term_positions[term]) {
+            merged.emplace_back(position, term);
+        }
+    }
+    if (non_empty < 2) {
+        return 0;
+    }
+    sort(merged.begin(), merged.end());
+    uint32_t distance = numeric_limits<uint32_t>::max();
+    for (size_t i = 1; i < merged.size(); ++i) {
+        if (merged[i].second != merged[i - 1].second) {
+            distance = min(distance, merged[i].first - merged[i - 1].first);
+        }
+    }
+    return distance;
+}
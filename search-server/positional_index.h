@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Позиции слов одного документа. Позиции каждого слова хранятся как разности
+// соседних значений в кодировке varint (7 бит на байт), поэтому короткие
+// расстояния между вхождениями занимают один байт.
+class DocumentPositions {
+public:
+    DocumentPositions() = default;
+    // positions[i] - возрастающие позиции i-го слова документа
+    explicit DocumentPositions(const std::vector<std::vector<uint32_t>>& positions);
+
+    std::vector<uint32_t> GetPositions(size_t term_index) const;
+    size_t GetMemoryUsage() const;
+
+private:
+    // позиции i-го слова лежат в data_[offsets_[i], offsets_[i + 1])
+    std::vector<uint32_t> offsets_;
+    std::vector<uint8_t> data_;
+};
+
+// Есть ли позиция p, такая что i-е слово фразы стоит на позиции p + i
+bool ContainsPhrase(const std::vector<std::vector<uint32_t>>& phrase_positions);
+
+// Наименьшее расстояние между вхождениями двух разных слов, 0 - если непустых списков меньше двух
+uint32_t ComputeMinimalDistance(const std::vector<std::vector<uint32_t>>& term_positions);
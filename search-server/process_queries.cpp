@@ -1,12 +1,54 @@
 #include "process_queries.h"
 
+// Пакет, работы которого хватает на все потоки, выполняется параллельно по запросам, каждый
+// запрос последовательно. Небольшой пакет идёт по очереди, и планировщик выбирает
+// выполнение для каждого запроса отдельно.
 std::vector<std::vector<Document>> ProcessQueries( const SearchServer& search_server, const std::vector<std::string>& queries){
     std:: vector<vector<Document>> result(queries.size());
-    transform(execution::par, make_move_iterator(queries.begin()), make_move_iterator(queries.end()), result.begin(),
+    if (search_server.PlanQueries(queries) == ExecutionPlan::BATCHED) {
+        transform(execution::par, queries.begin(), queries.end(), result.begin(),
+                  [&search_server](const string &query) { return search_server.FindTopDocuments(execution::seq, query); });
+    } else {
+        transform(queries.begin(), queries.end(), result.begin(),
                   [&search_server](const string &query) { return search_server.FindTopDocuments(query); });
+    }
     return result;
 } 
 
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries,
+                                                  QueryAnalytics& analytics) {
+    std::vector<std::vector<Document>> result(queries.size());
+    const bool batched = search_server.PlanQueries(queries) == ExecutionPlan::BATCHED;
+    const auto process = [&search_server, &analytics, batched](const string& query) {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<Document> documents = batched ? search_server.FindTopDocuments(execution::seq, query)
+                                                  : search_server.FindTopDocuments(query);
+        analytics.Record(query, documents.size(), std::chrono::steady_clock::now() - start);
+        return documents;
+    };
+    if (batched) {
+        transform(execution::par, queries.begin(), queries.end(), result.begin(), process);
+    } else {
+        transform(queries.begin(), queries.end(), result.begin(), process);
+    }
+    return result;
+}
+
+std::vector<SearchResult> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries,
+                                         const QueryControl& control) {
+    std::vector<std::future<SearchResult>> futures;
+    futures.reserve(queries.size());
+    for (const std::string& query : queries) {
+        futures.push_back(search_server.FindTopDocumentsAsync(query, control));
+    }
+    std::vector<SearchResult> result;
+    result.reserve(queries.size());
+    for (auto& future : futures) {
+        result.push_back(future.get());
+    }
+    return result;
+}
+
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries){
@@ -10,11 +10,24 @@
 #include <numeric>
 #include <string_view>
 #include "search_server.h"
+#include "query_analytics.h"
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries); 
 
+// То же, каждый запрос с задержкой и числом документов записывается в analytics из рабочего потока
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    QueryAnalytics& analytics);
+
 std::list<Document>  ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+// Запросы выполняются на пуле потоков сервера с общим крайним сроком/отменой
+std::vector<SearchResult> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    const QueryControl& control);
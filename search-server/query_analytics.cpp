@@ -0,0 +1,279 @@
+#include "query_analytics.h"
+#include "word_hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const uint64_t QUERY_HASH_SEED = 0xA11;
+// ячейка окна по времени: старшие биты - метка интервала, младшие - счётчик
+const int COUNT_BITS = 44;
+const uint64_t TAG_MASK = (uint64_t{1} << (64 - COUNT_BITS)) - 1;
+const uint64_t COUNT_MASK = (uint64_t{1} << COUNT_BITS) - 1;
+
+void IncrementTagged(atomic<uint64_t>& cell, uint64_t epoch) {
+    const uint64_t tag = epoch & TAG_MASK;
+    uint64_t current = cell.load(memory_order_relaxed);
+    while (true) {
+        const uint64_t current_tag = current >> COUNT_BITS;
+        uint64_t desired;
+        if (current_tag == tag) {
+            desired = current + 1;
+        } else if (((tag - current_tag) & TAG_MASK) <= TAG_MASK / 2) {
+            // в ячейке счётчик выбывшего интервала
+            desired = (tag << COUNT_BITS) | 1;
+        } else {
+            // запись опоздала: ячейка уже отдана более новому интервалу
+            return;
+        }
+        if (cell.compare_exchange_weak(current, desired, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+uint64_t ReadTagged(const atomic<uint64_t>& cell, uint64_t epoch) {
+    const uint64_t value = cell.load(memory_order_relaxed);
+    return (value >> COUNT_BITS) == (epoch & TAG_MASK) ? value & COUNT_MASK : 0;
+}
+
+uint32_t GetLatencyBucket(chrono::nanoseconds latency) {
+    uint64_t microseconds = static_cast<uint64_t>(max<int64_t>(chrono::duration_cast<chrono::microseconds>(latency).count(), 0));
+    uint32_t bucket = 0;
+    while (microseconds > 1 && bucket + 1 < LATENCY_BUCKET_COUNT) {
+        microseconds >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+}  // namespace
+
+QueryAnalytics::QueryAnalytics(const QueryAnalyticsOptions& options)
+    : options_(options) {
+    if (IsTimeWindow()) {
+        if (options_.time_buckets == 0) {
+            throw invalid_argument("Time window must have at least one bucket"s);
+        }
+        const size_t bucket_count = options_.time_buckets;
+        bucket_duration_ = max<Clock::duration>(chrono::duration_cast<Clock::duration>(options_.window_duration) / bucket_count,
+                                                Clock::duration(1));
+        tagged_counters_ = make_unique<atomic<uint64_t>[]>(bucket_count * COUNTER_COUNT);
+        tagged_sketch_ = make_unique<atomic<uint64_t>[]>(bucket_count * SKETCH_DEPTH * SKETCH_WIDTH);
+    } else {
+        slots_ = make_unique<atomic<uint64_t>[]>(options_.window_requests);
+        counters_ = make_unique<atomic<int64_t>[]>(COUNTER_COUNT);
+        sketch_ = make_unique<atomic<int64_t>[]>(SKETCH_DEPTH * SKETCH_WIDTH);
+    }
+}
+
+void QueryAnalytics::Record(string_view raw_query, size_t result_count, chrono::nanoseconds latency) {
+    const Entry entry{static_cast<uint32_t>(HashWord(raw_query, QUERY_HASH_SEED)), GetLatencyBucket(latency),
+                      static_cast<uint32_t>(min(result_count, RESULT_COUNT_BUCKET_COUNT - 1))};
+    const uint64_t sequence_number = record_count_.fetch_add(1, memory_order_relaxed);
+    if (IsTimeWindow()) {
+        ApplyTagged(entry, GetCurrentEpoch());
+    } else {
+        // запись, занимавшая ячейку, выбывает из окна и вычитается из счётчиков
+        const uint64_t evicted = slots_[sequence_number % options_.window_requests].exchange(PackEntry(entry), memory_order_acq_rel);
+        if (evicted != 0) {
+            Replace(UnpackEntry(evicted), entry);
+        } else {
+            Apply(entry, 1);
+        }
+    }
+
+    const uint64_t estimate = EstimateQueryHash(entry.query_hash);
+    if ((estimate > min_candidate_estimate_.load(memory_order_relaxed) && !IsCandidate(entry.query_hash))
+            || sequence_number % CANDIDATE_REFRESH_INTERVAL == 0) {
+        UpdateCandidates(raw_query, entry.query_hash, estimate);
+    }
+}
+
+uint64_t QueryAnalytics::GetNoResultRequests() const {
+    return ReadCounter(RESULT_COUNT_COUNTERS);
+}
+
+QueryStats QueryAnalytics::GetStats() const {
+    QueryStats stats;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+        stats.latency_histogram[i] = ReadCounter(LATENCY_COUNTERS + i);
+    }
+    for (size_t i = 0; i < RESULT_COUNT_BUCKET_COUNT; ++i) {
+        stats.result_count_histogram[i] = ReadCounter(RESULT_COUNT_COUNTERS + i);
+        stats.request_count += stats.result_count_histogram[i];
+    }
+    stats.no_result_count = stats.result_count_histogram[0];
+    return stats;
+}
+
+uint64_t QueryAnalytics::EstimateQueryCount(string_view raw_query) const {
+    return EstimateQueryHash(static_cast<uint32_t>(HashWord(raw_query, QUERY_HASH_SEED)));
+}
+
+vector<pair<string, uint64_t>> QueryAnalytics::GetTopQueries(size_t count) const {
+    vector<pair<string, uint64_t>> top_queries;
+    {
+        lock_guard guard(candidates_mutex_);
+        for (const auto& [query, query_hash] : candidates_) {
+            const uint64_t estimate = EstimateQueryHash(query_hash);
+            if (estimate > 0) {
+                top_queries.emplace_back(query, estimate);
+            }
+        }
+    }
+    sort(top_queries.begin(), top_queries.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+    });
+    if (top_queries.size() > count) {
+        top_queries.resize(count);
+    }
+    return top_queries;
+}
+
+bool QueryAnalytics::IsTimeWindow() const {
+    return options_.window_requests == 0;
+}
+
+uint64_t QueryAnalytics::GetCurrentEpoch() const {
+    return static_cast<uint64_t>((Clock::now() - start_time_) / bucket_duration_);
+}
+
+void QueryAnalytics::Apply(const Entry& entry, int64_t delta) {
+    counters_[LATENCY_COUNTERS + entry.latency_bucket].fetch_add(delta, memory_order_relaxed);
+    counters_[RESULT_COUNT_COUNTERS + entry.result_count_bucket].fetch_add(delta, memory_order_relaxed);
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        sketch_[row * SKETCH_WIDTH + GetSketchColumn(entry.query_hash, row)].fetch_add(delta, memory_order_relaxed);
+    }
+}
+
+// +1 и -1 в одной ячейке взаимно уничтожаются, такие ячейки не трогаем:
+// повторы одного запроса почти не стоят атомарных операций
+void QueryAnalytics::Replace(const Entry& evicted, const Entry& added) {
+    if (evicted.latency_bucket != added.latency_bucket) {
+        counters_[LATENCY_COUNTERS + added.latency_bucket].fetch_add(1, memory_order_relaxed);
+        counters_[LATENCY_COUNTERS + evicted.latency_bucket].fetch_sub(1, memory_order_relaxed);
+    }
+    if (evicted.result_count_bucket != added.result_count_bucket) {
+        counters_[RESULT_COUNT_COUNTERS + added.result_count_bucket].fetch_add(1, memory_order_relaxed);
+        counters_[RESULT_COUNT_COUNTERS + evicted.result_count_bucket].fetch_sub(1, memory_order_relaxed);
+    }
+    if (evicted.query_hash == added.query_hash) {
+        return;
+    }
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        const size_t added_column = GetSketchColumn(added.query_hash, row);
+        const size_t evicted_column = GetSketchColumn(evicted.query_hash, row);
+        if (added_column != evicted_column) {
+            sketch_[row * SKETCH_WIDTH + added_column].fetch_add(1, memory_order_relaxed);
+            sketch_[row * SKETCH_WIDTH + evicted_column].fetch_sub(1, memory_order_relaxed);
+        }
+    }
+}
+
+void QueryAnalytics::ApplyTagged(const Entry& entry, uint64_t epoch) {
+    const size_t bucket = epoch % options_.time_buckets;
+    atomic<uint64_t>* counters = &tagged_counters_[bucket * COUNTER_COUNT];
+    IncrementTagged(counters[LATENCY_COUNTERS + entry.latency_bucket], epoch);
+    IncrementTagged(counters[RESULT_COUNT_COUNTERS + entry.result_count_bucket], epoch);
+    atomic<uint64_t>* sketch = &tagged_sketch_[bucket * SKETCH_DEPTH * SKETCH_WIDTH];
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        IncrementTagged(sketch[row * SKETCH_WIDTH + GetSketchColumn(entry.query_hash, row)], epoch);
+    }
+}
+
+uint64_t QueryAnalytics::ReadCounter(size_t counter) const {
+    if (!IsTimeWindow()) {
+        return static_cast<uint64_t>(max<int64_t>(counters_[counter].load(memory_order_relaxed), 0));
+    }
+    const uint64_t epoch = GetCurrentEpoch();
+    uint64_t sum = 0;
+    for (uint64_t age = 0; age < options_.time_buckets && age <= epoch; ++age) {
+        const uint64_t bucket_epoch = epoch - age;
+        sum += ReadTagged(tagged_counters_[bucket_epoch % options_.time_buckets * COUNTER_COUNT + counter], bucket_epoch);
+    }
+    return sum;
+}
+
+uint64_t QueryAnalytics::EstimateQueryHash(uint32_t query_hash) const {
+    uint64_t estimate = numeric_limits<uint64_t>::max();
+    if (!IsTimeWindow()) {
+        for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+            const int64_t value = sketch_[row * SKETCH_WIDTH + GetSketchColumn(query_hash, row)].load(memory_order_relaxed);
+            estimate = min(estimate, static_cast<uint64_t>(max<int64_t>(value, 0)));
+        }
+        return estimate;
+    }
+    const uint64_t epoch = GetCurrentEpoch();
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        const size_t column = GetSketchColumn(query_hash, row);
+        uint64_t sum = 0;
+        for (uint64_t age = 0; age < options_.time_buckets && age <= epoch; ++age) {
+            const uint64_t bucket_epoch = epoch - age;
+            const size_t cell = (bucket_epoch % options_.time_buckets * SKETCH_DEPTH + row) * SKETCH_WIDTH + column;
+            sum += ReadTagged(tagged_sketch_[cell], bucket_epoch);
+        }
+        estimate = min(estimate, sum);
+    }
+    return estimate;
+}
+
+bool QueryAnalytics::IsCandidate(uint32_t query_hash) const {
+    return any_of(candidate_hashes_.begin(), candidate_hashes_.end(), [query_hash](const atomic<uint32_t>& candidate_hash) {
+        return candidate_hash.load(memory_order_relaxed) == query_hash;
+    });
+}
+
+void QueryAnalytics::UpdateCandidates(string_view raw_query, uint32_t query_hash, uint64_t estimate) {
+    // список кандидатов не критичен: если его уже обновляет другой поток, запрос просто не ждёт
+    unique_lock lock(candidates_mutex_, try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    const bool is_candidate = any_of(candidates_.begin(), candidates_.end(), [&](const auto& candidate) {
+        return candidate.second == query_hash && candidate.first == raw_query;
+    });
+    if (!is_candidate && candidates_.size() < TOP_QUERY_CANDIDATES) {
+        candidate_hashes_[candidates_.size()].store(query_hash, memory_order_relaxed);
+        candidates_.emplace_back(raw_query, query_hash);
+    }
+
+    // пересчитываем оценки кандидатов и вытесняем самого редкого, если новый запрос чаще
+    size_t weakest = 0;
+    uint64_t weakest_estimate = numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < candidates_.size(); ++i) {
+        const uint64_t candidate_estimate = EstimateQueryHash(candidates_[i].second);
+        if (candidate_estimate < weakest_estimate) {
+            weakest = i;
+            weakest_estimate = candidate_estimate;
+        }
+    }
+    if (!is_candidate && candidates_.size() == TOP_QUERY_CANDIDATES && estimate > weakest_estimate
+            && !(candidates_[weakest].second == query_hash && candidates_[weakest].first == raw_query)) {
+        candidates_[weakest] = {string(raw_query), query_hash};
+        candidate_hashes_[weakest].store(query_hash, memory_order_relaxed);
+        weakest_estimate = estimate;
+        for (const auto& candidate : candidates_) {
+            weakest_estimate = min(weakest_estimate, EstimateQueryHash(candidate.second));
+        }
+    }
+    min_candidate_estimate_.store(candidates_.size() < TOP_QUERY_CANDIDATES ? 0 : weakest_estimate, memory_order_relaxed);
+}
+
+size_t QueryAnalytics::GetSketchColumn(uint32_t query_hash, size_t row) {
+    static const uint32_t ROW_MULTIPLIERS[SKETCH_DEPTH] = {0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu};
+    return ((query_hash ^ static_cast<uint32_t>(row * 0x7F4A7C15u)) * ROW_MULTIPLIERS[row]) >> 22;
+}
+
+uint64_t QueryAnalytics::PackEntry(const Entry& entry) {
+    // бит 0 отличает занятую ячейку от пустой
+    return uint64_t{entry.query_hash} << 32 | uint64_t{entry.latency_bucket} << 4 | uint64_t{entry.result_count_bucket} << 1 | 1;
+}
+
+QueryAnalytics::Entry QueryAnalytics::UnpackEntry(uint64_t packed) {
+    return {static_cast<uint32_t>(packed >> 32), static_cast<uint32_t>(packed >> 4) & 0x1F, static_cast<uint32_t>(packed >> 1) & 0x7};
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Окно по умолчанию - последние 1440 запросов
+const size_t DEFAULT_WINDOW_REQUESTS = 1440;
+// Гистограмма задержек: корзина i - от 2^i до 2^(i+1) микросекунд, последняя - всё, что дольше
+const size_t LATENCY_BUCKET_COUNT = 24;
+// Гистограмма числа найденных документов: корзина i - ровно i документов, последняя - столько и больше
+const size_t RESULT_COUNT_BUCKET_COUNT = 8;
+
+struct QueryAnalyticsOptions {
+    // окно из последних window_requests запросов; 0 - окно по времени window_duration
+    size_t window_requests = DEFAULT_WINDOW_REQUESTS;
+    std::chrono::milliseconds window_duration{60'000};
+    // на сколько частей делится окно по времени: старые части выбывают целиком
+    size_t time_buckets = 16;
+};
+
+// Снимок счётчиков окна
+struct QueryStats {
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    std::array<uint64_t, LATENCY_BUCKET_COUNT> latency_histogram{};
+    std::array<uint64_t, RESULT_COUNT_BUCKET_COUNT> result_count_histogram{};
+};
+
+// Статистика запросов в скользящем окне. Record можно вызывать из любого числа
+// потоков без блокировок: окно по числу запросов - кольцевой буфер упакованных в
+// 64 бита записей, вытесненная запись вычитается из счётчиков, поэтому счётчики
+// читаются за O(1). Окно по времени - time_buckets наборов счётчиков, помеченных
+// номером интервала; устаревший счётчик обнуляется первой же записью в него.
+// Частоты запросов оцениваются count-min sketch; кандидаты в самые частые запросы
+// хранятся отдельно, их список обновляется только если блокировка свободна.
+// Сами результаты запросов не хранятся.
+class QueryAnalytics {
+public:
+    explicit QueryAnalytics(const QueryAnalyticsOptions& options = {});
+
+    void Record(std::string_view raw_query, size_t result_count, std::chrono::nanoseconds latency);
+
+    uint64_t GetNoResultRequests() const;
+    QueryStats GetStats() const;
+    // Оценка сверху числа запросов raw_query в окне
+    uint64_t EstimateQueryCount(std::string_view raw_query) const;
+    // Не более count самых частых запросов окна с оценками их числа
+    std::vector<std::pair<std::string, uint64_t>> GetTopQueries(size_t count) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t SKETCH_DEPTH = 4;
+    static const size_t SKETCH_WIDTH = 1024;
+    static const size_t TOP_QUERY_CANDIDATES = 32;
+    // так часто кандидаты пересматриваются независимо от оценки запроса: оценки в окне стареют
+    static const uint64_t CANDIDATE_REFRESH_INTERVAL = 1024;
+    // счётчики набора: корзины задержек и корзины числа документов; число запросов
+    // и пустые результаты выводятся из второй гистограммы
+    static const size_t LATENCY_COUNTERS = 0;
+    static const size_t RESULT_COUNT_COUNTERS = LATENCY_COUNTERS + LATENCY_BUCKET_COUNT;
+    static const size_t COUNTER_COUNT = RESULT_COUNT_COUNTERS + RESULT_COUNT_BUCKET_COUNT;
+
+    struct Entry {
+        uint32_t query_hash;
+        uint32_t latency_bucket;
+        uint32_t result_count_bucket;
+    };
+
+    bool IsTimeWindow() const;
+    uint64_t GetCurrentEpoch() const;
+    void Apply(const Entry& entry, int64_t delta);
+    void Replace(const Entry& evicted, const Entry& added);
+    void ApplyTagged(const Entry& entry, uint64_t epoch);
+    uint64_t ReadCounter(size_t counter) const;
+    uint64_t EstimateQueryHash(uint32_t query_hash) const;
+    bool IsCandidate(uint32_t query_hash) const;
+    void UpdateCandidates(std::string_view raw_query, uint32_t query_hash, uint64_t estimate);
+
+    static size_t GetSketchColumn(uint32_t query_hash, size_t row);
+    static uint64_t PackEntry(const Entry& entry);
+    static Entry UnpackEntry(uint64_t packed);
+
+    const QueryAnalyticsOptions options_;
+    const Clock::time_point start_time_ = Clock::now();
+    Clock::duration bucket_duration_{};
+    std::atomic<uint64_t> record_count_{0};
+
+    // окно по числу запросов
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+    std::unique_ptr<std::atomic<int64_t>[]> counters_;
+    std::unique_ptr<std::atomic<int64_t>[]> sketch_;
+
+    // окно по времени: time_buckets наборов счётчиков и скетчей с метками интервала
+    std::unique_ptr<std::atomic<uint64_t>[]> tagged_counters_;
+    std::unique_ptr<std::atomic<uint64_t>[]> tagged_sketch_;
+
+    mutable std::mutex candidates_mutex_;
+    std::vector<std::pair<std::string, uint32_t>> candidates_;
+    // хеши кандидатов для проверки без блокировки: частому запросу-кандидату незачем её брать
+    std::array<std::atomic<uint32_t>, TOP_QUERY_CANDIDATES> candidate_hashes_{};
+    // наименьшая оценка среди кандидатов: запросы с оценкой не выше блокировку не трогают
+    std::atomic<uint64_t> min_candidate_estimate_{0};
+};
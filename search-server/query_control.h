@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Флаг отмены, разделяемый между вызывающим кодом и выполняющимся запросом
+class CancellationToken {
+public:
+    CancellationToken()
+        : cancelled_(std::make_shared<std::atomic_bool>(false)) {
+    }
+
+    void Cancel() const {
+        cancelled_->store(true, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const {
+        return cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class QueryControl;
+    std::shared_ptr<std::atomic_bool> cancelled_;
+};
+
+// Ограничения выполнения запроса: крайний срок и/или токен отмены.
+// Проверяется между блоками списков документов, по умолчанию запрос не ограничен.
+class QueryControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    QueryControl() = default;
+
+    explicit QueryControl(Clock::time_point deadline)
+        : deadline_(deadline) {
+    }
+
+    explicit QueryControl(const CancellationToken& token)
+        : cancelled_(token.cancelled_) {
+    }
+
+    QueryControl(Clock::time_point deadline, const CancellationToken& token)
+        : deadline_(deadline)
+        , cancelled_(token.cancelled_) {
+    }
+
+    static QueryControl WithTimeout(Clock::duration timeout) {
+        return QueryControl(Clock::now() + timeout);
+    }
+
+    bool IsExpired() const {
+        if (cancelled_ && cancelled_->load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return deadline_ != Clock::time_point::max() && Clock::now() >= deadline_;
+    }
+
+private:
+    Clock::time_point deadline_ = Clock::time_point::max();
+    std::shared_ptr<const std::atomic_bool> cancelled_;
+};
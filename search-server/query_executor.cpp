@@ -0,0 +1,44 @@
+#include "query_executor.h"
+
+using namespace std;
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = max(1u, thread::hardware_concurrency());
+    }
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_task_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+    return workers_.size();
+}
+
+void QueryExecutor::WorkerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            has_task_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Пул потоков, на котором сервер выполняет асинхронные запросы
+class QueryExecutor {
+public:
+    explicit QueryExecutor(size_t thread_count);
+    ~QueryExecutor();
+
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task);
+
+    size_t GetThreadCount() const;
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    bool stopping_ = false;
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> QueryExecutor::Submit(Task task) {
+    using Result = std::invoke_result_t<Task>;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    auto future = packaged->get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back([packaged] { (*packaged)(); });
+    }
+    has_task_.notify_one();
+    return future;
+}
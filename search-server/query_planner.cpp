@@ -0,0 +1,83 @@
+#include "query_planner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t CALIBRATION_MIN_SIZE = 1 << 9;
+const size_t CALIBRATION_MAX_SIZE = 1 << 18;
+const int CALIBRATION_REPEATS = 3;
+// параллельная версия должна быть быстрее хотя бы на столько, иначе выигрыш в шуме
+const double CALIBRATION_MIN_SPEEDUP = 1.25;
+
+struct CalibrationData {
+    vector<double> term_freqs;
+    vector<uint8_t> statuses;
+    vector<double> relevances;
+};
+
+// лучшее из нескольких измерений: первое обычно платит за прогрев кеша и потоков
+template <typename ExecutionPolicy>
+chrono::nanoseconds MeasureScoring(ExecutionPolicy&& policy, CalibrationData& data, size_t size) {
+    chrono::nanoseconds best = chrono::nanoseconds::max();
+    for (int repeat = 0; repeat < CALIBRATION_REPEATS; ++repeat) {
+        const auto start = chrono::steady_clock::now();
+        transform(policy, data.term_freqs.begin(), data.term_freqs.begin() + size, data.statuses.begin(), data.relevances.begin(),
+                  [](double term_freq, uint8_t status) {
+            return status == 0 ? term_freq * 1.5 : 0.0;
+        });
+        best = min(best, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start));
+    }
+    return best;
+}
+
+}  // namespace
+
+QueryCostModel CalibrateQueryCostModel() {
+    QueryCostModel model;
+    model.thread_count = max(1u, thread::hardware_concurrency());
+    if (model.thread_count == 1) {
+        return model;
+    }
+    CalibrationData data;
+    mt19937 generator(1);
+    data.term_freqs.resize(CALIBRATION_MAX_SIZE);
+    data.statuses.resize(CALIBRATION_MAX_SIZE);
+    data.relevances.resize(CALIBRATION_MAX_SIZE);
+    for (size_t i = 0; i < CALIBRATION_MAX_SIZE; ++i) {
+        data.term_freqs[i] = uniform_real_distribution(0.0, 1.0)(generator);
+        data.statuses[i] = static_cast<uint8_t>(generator() % 4);
+    }
+    for (size_t size = CALIBRATION_MIN_SIZE; size <= CALIBRATION_MAX_SIZE; size *= 2) {
+        const auto sequential = MeasureScoring(execution::seq, data, size);
+        const auto parallel = MeasureScoring(execution::par, data, size);
+        if (parallel.count() * CALIBRATION_MIN_SPEEDUP < sequential.count()) {
+            model.parallel_min_work = size;
+            break;
+        }
+    }
+    return model;
+}
+
+const QueryCostModel& GetCalibratedQueryCostModel() {
+    static const QueryCostModel model = CalibrateQueryCostModel();
+    return model;
+}
+
+QueryCostModel MakeQueryCostModel(size_t parallel_min_work) {
+    if (parallel_min_work == 0) {
+        return GetCalibratedQueryCostModel();
+    }
+    QueryCostModel model;
+    model.thread_count = max(1u, thread::hardware_concurrency());
+    model.parallel_min_work = parallel_min_work;
+    return model;
+}
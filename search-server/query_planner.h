@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+// Как выполнить запрос, для которого вызывающий не указал политику выполнения
+enum class ExecutionPlan {
+    // в вызывающем потоке; для пакета - запросы по очереди, каждый по своему плану
+    SEQUENTIAL,
+    // слова и документы одного запроса обрабатываются параллельно
+    PARALLEL,
+    // запросы пакета выполняются параллельно друг другу, каждый последовательно
+    BATCHED,
+};
+
+// Порог, с которым запрос никогда не выполняется параллельно
+const size_t NEVER_PARALLEL = std::numeric_limits<size_t>::max();
+
+// Единица работы - один элемент списка документов, обработанный ядром с фильтром по статусу.
+// parallel_min_work - с какой оценки работы параллельное выполнение быстрее последовательного.
+struct QueryCostModel {
+    size_t thread_count = 1;
+    size_t parallel_min_work = NEVER_PARALLEL;
+};
+
+// Микробенчмарк: ядро ранжирования по статусу на массивах растущей длины выполняется
+// последовательно и параллельно, порог - первая длина, на которой параллельная версия
+// заметно быстрее. На одном ядре измерение не проводится и порог - NEVER_PARALLEL.
+QueryCostModel CalibrateQueryCostModel();
+// Калибровка выполняется один раз за процесс, при первом вызове
+const QueryCostModel& GetCalibratedQueryCostModel();
+// parallel_min_work == 0 - порог из калибровки, иначе заданный
+QueryCostModel MakeQueryCostModel(size_t parallel_min_work);
@@ -2,36 +2,38 @@
 
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-    QueryResult rezult;
-    rezult.rez=ser.FindTopDocuments( raw_query,  status);
-    if(requests_.size()==sec_in_day_)
-        requests_.pop_front();
-    requests_.push_back(rezult);
+    const auto start = chrono::steady_clock::now();
+    vector<Document> rez=ser.FindTopDocuments( raw_query,  status);
+    analytics_.Record(raw_query, rez.size(), chrono::steady_clock::now() - start);
 
-    return   rezult.rez;
+    return   rez;
 }
 
 vector<Document> RequestQueue:: AddFindRequest(const string& raw_query) {
-    QueryResult rezult;
-    rezult.rez=ser.FindTopDocuments(raw_query);
-    if(requests_.size()==sec_in_day_)
-        requests_.pop_front();
-    requests_.push_back(rezult);
+    const auto start = chrono::steady_clock::now();
+    vector<Document> rez=ser.FindTopDocuments(raw_query);
+    analytics_.Record(raw_query, rez.size(), chrono::steady_clock::now() - start);
 
-    return   rezult.rez;
+    return   rez;
 }
 
-RequestQueue:: RequestQueue(const SearchServer& search_server):ser(search_server){
+SearchResult RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status, const QueryControl& control) {
+    const auto start = chrono::steady_clock::now();
+    SearchResult search_result = ser.FindTopDocumentsAsync(raw_query, status, control).get();
+    analytics_.Record(raw_query, search_result.documents.size(), chrono::steady_clock::now() - start);
+
+    return search_result;
+}
+
+RequestQueue:: RequestQueue(const SearchServer& search_server, const QueryAnalyticsOptions& options)
+    : analytics_(options), ser(search_server){
 
 }
 
 int RequestQueue:: GetNoResultRequests() const {
-    int sum=0;
-    for(auto a:requests_)
-    {
-        if(a.rez.size()==0)
-            sum++;
-    }
-    return sum;
+    return static_cast<int>(analytics_.GetNoResultRequests());
+}
 
+const QueryAnalytics& RequestQueue:: GetAnalytics() const {
+    return analytics_;
 }
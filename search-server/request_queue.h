@@ -1,39 +1,38 @@
 #pragma once
 #include "search_server.h"
 #include "document.h"
-#include <set>
-#include <deque>
+#include "query_analytics.h"
+#include <chrono>
 
 
 using namespace std;
 
+// История запросов хранится в QueryAnalytics: AddFindRequest можно вызывать из разных потоков,
+// а GetNoResultRequests отвечает за O(1) без обхода окна
 class RequestQueue {
 public:
-    explicit  RequestQueue(const SearchServer& search_server);
+    explicit  RequestQueue(const SearchServer& search_server, const QueryAnalyticsOptions& options = {});
 
     vector<Document> AddFindRequest(const string& raw_query, DocumentStatus status);
     vector<Document> AddFindRequest(const string& raw_query);
     template <typename DocumentPredicate>
     vector<Document>   AddFindRequest(const string& raw_query, DocumentPredicate document_predicate);
+    // запрос с крайним сроком/отменой; прерванный запрос учитывается с найденными к этому моменту документами
+    SearchResult AddFindRequest(const string& raw_query, DocumentStatus status, const QueryControl& control);
     int GetNoResultRequests() const;
+    // гистограммы задержек и числа документов, самые частые запросы окна
+    const QueryAnalytics& GetAnalytics() const;
 
 private:
-    struct QueryResult {
-        vector<Document>rez;
-        int num;
-    };
-    deque<QueryResult> requests_;
-    const static int sec_in_day_ = 1440;
+    QueryAnalytics analytics_;
     const SearchServer& ser;
 };
 
 template <typename DocumentPredicate>
 vector<Document>  RequestQueue:: AddFindRequest(const string& raw_query, DocumentPredicate document_predicate) {
-    QueryResult rezult;
-    rezult.rez=ser.FindTopDocuments(  raw_query,  document_predicate);
-    if(requests_.size()==sec_in_day_)
-        requests_.pop_front();
-    requests_.push_back(rezult);
+    const auto start = chrono::steady_clock::now();
+    vector<Document> rez=ser.FindTopDocuments(  raw_query,  document_predicate);
+    analytics_.Record(raw_query, rez.size(), chrono::steady_clock::now() - start);
 
-    return   rezult.rez;
+    return   rez;
 }
@@ -0,0 +1,249 @@
+#include "roaring_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+bool RoaringBitmap::Container::Contains(uint16_t low) const {
+    if (IsBitmap()) {
+        return bits[low / 64] >> (low % 64) & 1;
+    }
+    return binary_search(values.begin(), values.end(), low);
+}
+
+void RoaringBitmap::Container::ToBitmap() {
+    bits.assign(BITMAP_WORDS, 0);
+    for (const uint16_t low : values) {
+        bits[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    vector<uint16_t>().swap(values);
+}
+
+void RoaringBitmap::Container::ToArray() {
+    values.clear();
+    values.reserve(cardinality);
+    for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+        for (uint64_t word_bits = bits[word]; word_bits != 0; word_bits &= word_bits - 1) {
+            values.push_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(word_bits)));
+        }
+    }
+    vector<uint64_t>().swap(bits);
+}
+
+void RoaringBitmap::Container::Normalize() {
+    if (!IsBitmap()) {
+        cardinality = static_cast<uint32_t>(values.size());
+        return;
+    }
+    cardinality = 0;
+    for (const uint64_t word_bits : bits) {
+        cardinality += __builtin_popcountll(word_bits);
+    }
+    if (cardinality <= ARRAY_CONTAINER_MAX_SIZE) {
+        ToArray();
+    }
+}
+
+RoaringBitmap::RoaringBitmap(const int* first, const int* last) {
+    // контейнер сразу строится нужного вида по отрезку значений с общими старшими битами
+    while (first != last) {
+        const uint16_t key = static_cast<uint16_t>(static_cast<uint32_t>(*first) >> 16);
+        const int* run_end = first;
+        while (run_end != last && static_cast<uint16_t>(static_cast<uint32_t>(*run_end) >> 16) == key) {
+            ++run_end;
+        }
+        Container& container = containers_.emplace_back();
+        keys_.push_back(key);
+        container.cardinality = static_cast<uint32_t>(run_end - first);
+        if (container.cardinality > ARRAY_CONTAINER_MAX_SIZE) {
+            container.bits.assign(BITMAP_WORDS, 0);
+            for (; first != run_end; ++first) {
+                const uint16_t low = static_cast<uint16_t>(*first);
+                container.bits[low / 64] |= uint64_t{1} << (low % 64);
+            }
+        } else {
+            container.values.reserve(container.cardinality);
+            for (; first != run_end; ++first) {
+                container.values.push_back(static_cast<uint16_t>(*first));
+            }
+        }
+        cardinality_ += container.cardinality;
+    }
+}
+
+size_t RoaringBitmap::FindContainer(uint16_t key) const {
+    const auto it = lower_bound(keys_.begin(), keys_.end(), key);
+    return it != keys_.end() && *it == key ? it - keys_.begin() : keys_.size();
+}
+
+RoaringBitmap::Container& RoaringBitmap::GetOrAddContainer(uint16_t key) {
+    // значения обычно добавляются по возрастанию - в последний контейнер
+    if (!keys_.empty() && keys_.back() == key) {
+        return containers_.back();
+    }
+    const auto it = lower_bound(keys_.begin(), keys_.end(), key);
+    const size_t pos = it - keys_.begin();
+    if (it == keys_.end() || *it != key) {
+        keys_.insert(it, key);
+        containers_.insert(containers_.begin() + pos, Container{});
+    }
+    return containers_[pos];
+}
+
+void RoaringBitmap::Add(uint32_t value) {
+    Container& container = GetOrAddContainer(static_cast<uint16_t>(value >> 16));
+    const auto low = static_cast<uint16_t>(value);
+    if (container.IsBitmap()) {
+        uint64_t& word = container.bits[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if (word & bit) {
+            return;
+        }
+        word |= bit;
+    } else {
+        auto& values = container.values;
+        if (values.empty() || values.back() < low) {
+            values.push_back(low);
+        } else {
+            const auto it = lower_bound(values.begin(), values.end(), low);
+            if (*it == low) {
+                return;
+            }
+            values.insert(it, low);
+        }
+        if (values.size() > ARRAY_CONTAINER_MAX_SIZE) {
+            container.ToBitmap();
+        }
+    }
+    ++container.cardinality;
+    ++cardinality_;
+}
+
+bool RoaringBitmap::Remove(uint32_t value) {
+    const size_t pos = FindContainer(static_cast<uint16_t>(value >> 16));
+    if (pos == keys_.size()) {
+        return false;
+    }
+    Container& container = containers_[pos];
+    const auto low = static_cast<uint16_t>(value);
+    if (container.IsBitmap()) {
+        uint64_t& word = container.bits[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if ((word & bit) == 0) {
+            return false;
+        }
+        word &= ~bit;
+        if (--container.cardinality <= ARRAY_CONTAINER_MAX_SIZE) {
+            container.ToArray();
+        }
+    } else {
+        const auto it = lower_bound(container.values.begin(), container.values.end(), low);
+        if (it == container.values.end() || *it != low) {
+            return false;
+        }
+        container.values.erase(it);
+        --container.cardinality;
+    }
+    if (container.cardinality == 0) {
+        keys_.erase(keys_.begin() + pos);
+        containers_.erase(containers_.begin() + pos);
+    }
+    --cardinality_;
+    return true;
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+    const size_t pos = FindContainer(static_cast<uint16_t>(value >> 16));
+    return pos != keys_.size() && containers_[pos].Contains(static_cast<uint16_t>(value));
+}
+
+size_t RoaringBitmap::Rank(uint32_t value) const {
+    const auto key = static_cast<uint16_t>(value >> 16);
+    const auto low = static_cast<uint16_t>(value);
+    size_t rank = 0;
+    for (size_t pos = 0; pos < keys_.size() && keys_[pos] <= key; ++pos) {
+        const Container& container = containers_[pos];
+        if (keys_[pos] < key) {
+            rank += container.cardinality;
+        } else if (container.IsBitmap()) {
+            for (size_t word = 0; word < low / 64; ++word) {
+                rank += __builtin_popcountll(container.bits[word]);
+            }
+            rank += __builtin_popcountll(container.bits[low / 64] & ((uint64_t{1} << (low % 64)) - 1));
+        } else {
+            rank += lower_bound(container.values.begin(), container.values.end(), low) - container.values.begin();
+        }
+    }
+    return rank;
+}
+
+void RoaringBitmap::AndNot(const RoaringBitmap& other) {
+    size_t kept = 0;
+    for (size_t pos = 0; pos < keys_.size(); ++pos) {
+        Container& container = containers_[pos];
+        const size_t other_pos = other.FindContainer(keys_[pos]);
+        if (other_pos != other.keys_.size()) {
+            const Container& excluded = other.containers_[other_pos];
+            if (container.IsBitmap()) {
+                if (excluded.IsBitmap()) {
+                    for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+                        container.bits[word] &= ~excluded.bits[word];
+                    }
+                } else {
+                    for (const uint16_t low : excluded.values) {
+                        container.bits[low / 64] &= ~(uint64_t{1} << (low % 64));
+                    }
+                }
+            } else {
+                auto& values = container.values;
+                values.erase(remove_if(values.begin(), values.end(), [&excluded](uint16_t low) {
+                    return excluded.Contains(low);
+                }), values.end());
+            }
+            container.Normalize();
+        }
+        if (container.cardinality != 0) {
+            if (kept != pos) {
+                keys_[kept] = keys_[pos];
+                containers_[kept] = move(container);
+            }
+            ++kept;
+        }
+    }
+    keys_.resize(kept);
+    containers_.resize(kept);
+    RecountCardinality();
+}
+
+void RoaringBitmap::Decode(int* out) const {
+    for (size_t pos = 0; pos < keys_.size(); ++pos) {
+        const uint32_t high = uint32_t{keys_[pos]} << 16;
+        const Container& container = containers_[pos];
+        if (container.IsBitmap()) {
+            for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+                for (uint64_t word_bits = container.bits[word]; word_bits != 0; word_bits &= word_bits - 1) {
+                    *out++ = static_cast<int>(high | static_cast<uint32_t>(word * 64 + __builtin_ctzll(word_bits)));
+                }
+            }
+        } else {
+            for (const uint16_t low : container.values) {
+                *out++ = static_cast<int>(high | low);
+            }
+        }
+    }
+}
+
+size_t RoaringBitmap::GetMemoryUsage() const {
+    size_t memory = keys_.capacity() * sizeof(uint16_t) + containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        memory += container.values.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return memory;
+}
+
+void RoaringBitmap::RecountCardinality() {
+    cardinality_ = 0;
+    for (const Container& container : containers_) {
+        cardinality_ += container.cardinality;
+    }
+}
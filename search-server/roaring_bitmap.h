@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатое множество 32-битных чисел (схема Roaring): числа делятся по старшим 16 битам
+// на контейнеры, контейнер до ARRAY_CONTAINER_MAX_SIZE чисел хранит отсортированный
+// массив младших 16 бит, более плотный - 65536 бит. Плотный список документов частого
+// слова занимает 1 бит на id вместо 32, а пересечение и вычитание идут по словам
+// битовых карт.
+class RoaringBitmap {
+public:
+    static const size_t ARRAY_CONTAINER_MAX_SIZE = 4096;
+
+    RoaringBitmap() = default;
+    // values отсортированы по возрастанию, без повторов
+    RoaringBitmap(const int* first, const int* last);
+
+    void Add(uint32_t value);
+    bool Remove(uint32_t value);
+    bool Contains(uint32_t value) const;
+
+    size_t GetCardinality() const {
+        return cardinality_;
+    }
+    // Число элементов, меньших value
+    size_t Rank(uint32_t value) const;
+
+    void AndNot(const RoaringBitmap& other);
+
+    // Элементы по возрастанию, в out должно поместиться GetCardinality() значений
+    void Decode(int* out) const;
+    // function(value, rank) для элементов, которые есть и в mask; rank - номер элемента
+    // в этом множестве. Перед каждым контейнером вызывается stop(), true прерывает обход.
+    template <typename Function, typename StopPredicate>
+    bool ForEachAnd(const RoaringBitmap& mask, Function function, StopPredicate stop) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    static const size_t BITMAP_WORDS = 65536 / 64;
+
+    struct Container {
+        // пусто, если контейнер хранится битовой картой
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> bits;
+        uint32_t cardinality = 0;
+
+        bool IsBitmap() const {
+            return !bits.empty();
+        }
+        bool Contains(uint16_t low) const;
+        void ToBitmap();
+        void ToArray();
+        // после изменения битовой карты: пересчёт мощности и переход к массиву, если он короче
+        void Normalize();
+    };
+
+    size_t FindContainer(uint16_t key) const;
+    Container& GetOrAddContainer(uint16_t key);
+    void RecountCardinality();
+
+    std::vector<uint16_t> keys_;
+    std::vector<Container> containers_;
+    size_t cardinality_ = 0;
+};
+
+template <typename Function, typename StopPredicate>
+bool RoaringBitmap::ForEachAnd(const RoaringBitmap& mask, Function function, StopPredicate stop) const {
+    size_t rank_base = 0;
+    size_t mask_pos = 0;
+    for (size_t pos = 0; pos < keys_.size(); rank_base += containers_[pos++].cardinality) {
+        while (mask_pos < mask.keys_.size() && mask.keys_[mask_pos] < keys_[pos]) {
+            ++mask_pos;
+        }
+        if (mask_pos == mask.keys_.size()) {
+            break;
+        }
+        if (mask.keys_[mask_pos] != keys_[pos]) {
+            continue;
+        }
+        if (stop()) {
+            return false;
+        }
+        const uint32_t high = uint32_t{keys_[pos]} << 16;
+        const Container& container = containers_[pos];
+        const Container& mask_container = mask.containers_[mask_pos];
+        if (container.IsBitmap() && mask_container.IsBitmap()) {
+            // номер элемента - число единиц до него в этом контейнере; слова без общих
+            // единиц пропускаются целиком, в остальных номер растёт на каждом элементе
+            size_t rank = rank_base;
+            for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+                const uint64_t bits = container.bits[word];
+                const uint64_t matched = bits & mask_container.bits[word];
+                if (matched == 0) {
+                    rank += __builtin_popcountll(bits);
+                    continue;
+                }
+                for (uint64_t rest = bits; rest != 0; rest &= rest - 1, ++rank) {
+                    const int bit = __builtin_ctzll(rest);
+                    if (matched >> bit & 1) {
+                        function(high | static_cast<uint32_t>(word * 64 + bit), rank);
+                    }
+                }
+            }
+        } else if (container.IsBitmap()) {
+            size_t rank = rank_base;
+            size_t counted_words = 0;
+            for (const uint16_t low : mask_container.values) {
+                const size_t word = low / 64;
+                const uint64_t bits = container.bits[word];
+                if ((bits >> (low % 64) & 1) == 0) {
+                    continue;
+                }
+                for (; counted_words < word; ++counted_words) {
+                    rank += __builtin_popcountll(container.bits[counted_words]);
+                }
+                function(high | low, rank + __builtin_popcountll(bits & ((uint64_t{1} << (low % 64)) - 1)));
+            }
+        } else if (mask_container.IsBitmap()) {
+            for (size_t i = 0; i < container.values.size(); ++i) {
+                const uint16_t low = container.values[i];
+                if (mask_container.bits[low / 64] >> (low % 64) & 1) {
+                    function(high | low, rank_base + i);
+                }
+            }
+        } else {
+            const auto& values = container.values;
+            const auto& mask_values = mask_container.values;
+            for (size_t i = 0, j = 0; i < values.size() && j < mask_values.size();) {
+                if (values[i] < mask_values[j]) {
+                    ++i;
+                } else if (mask_values[j] < values[i]) {
+                    ++j;
+                } else {
+                    function(high | values[i], rank_base + i);
+                    ++i;
+                    ++j;
+                }
+            }
+        }
+    }
+    return true;
+}
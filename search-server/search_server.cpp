@@ -5,49 +5,123 @@ void SearchServer:: AddDocument(int document_id,  string_view  document, Documen
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
+    AddDocument(PrepareDocument(document_id, document, status, ratings));
+}
+
+PreparedDocument SearchServer:: PrepareDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) const {
+    PreparedDocument prepared{document_id, status, ComputeAverageRating(ratings), string(document), {}};
+    for (const string_view word : SplitIntoWordsNoStop(document)) {
+        prepared.words.emplace_back(static_cast<uint32_t>(word.data() - document.data()), static_cast<uint32_t>(word.size()));
+    }
+    return prepared;
+}
+
+void SearchServer:: AddDocument(PreparedDocument prepared) {
+    const int document_id = prepared.id;
+    const DocumentStatus status = prepared.status;
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    if (write_ahead_log_) {
+        if (prepared.text.size() > MAX_LOG_TEXT_SIZE) {
+            throw invalid_argument("Document is too long for the write-ahead log"s);
+        }
+        // запись журнала идёт раньше индекса: если она не удалась, документа нет и в поиске
+        write_ahead_log_->AppendAdd(document_id, status, prepared.rating, prepared.text);
+    }
+    // старые записи документа с тем же id должны уйти из списков до вставки новых
+    if (IsDocumentRemoved(document_id)) {
+        PurgeRemovedDocuments();
+    }
 
-    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, std::string(document) });
+    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ prepared.rating, status, move(prepared.text) });
     document_ids_.insert(document_id);
-    const auto words = SplitIntoWordsNoStop(it->second.str);
+    status_documents_[static_cast<size_t>(status)].Add(static_cast<uint32_t>(document_id));
+    const string_view text = it->second.str;
+    vector<string_view> words;
+    words.reserve(prepared.words.size());
+    for (const auto& [offset, length] : prepared.words) {
+        words.push_back(text.substr(offset, length));
+    }
 
 
     const double inv_word_count = 1.0 / words.size();
+    vector<int> word_term_ids;
+    word_term_ids.reserve(words.size());
     for (const auto  word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
-        docs_duplecats[document_id].insert(string(word));
+        word_term_ids.push_back(GetOrAddTermId(word));
+    }
+    vector<int> sorted_term_ids = word_term_ids;
+    sort(sorted_term_ids.begin(), sorted_term_ids.end());
+
+    // частоты считаются по отсортированным id: словари документа заполняются
+    // один раз на слово, а не на каждое его вхождение
+    vector<int>& term_ids = document_terms_[document_id];
+    vector<double> term_freqs;
+    auto& document_word_freqs = document_to_word_freqs_[document_id];
+    auto& document_words = docs_duplecats[document_id];
+    for (auto first = sorted_term_ids.begin(); first != sorted_term_ids.end();) {
+        const auto last = upper_bound(first, sorted_term_ids.end(), *first);
+        const string_view term = terms_[*first];
+        term_ids.push_back(*first);
+        term_freqs.push_back((last - first) * inv_word_count);
+        document_word_freqs.emplace(term, term_freqs.back());
+        document_words.emplace(term);
+        first = last;
+    }
+    term_ids.shrink_to_fit();
+
+    if (options_.positional_index) {
+        vector<vector<uint32_t>> positions(term_ids.size());
+        for (size_t position = 0; position < word_term_ids.size(); ++position) {
+            const auto term_index = lower_bound(term_ids.begin(), term_ids.end(), word_term_ids[position]) - term_ids.begin();
+            positions[term_index].push_back(static_cast<uint32_t>(position));
+        }
+        document_positions_.emplace(document_id, DocumentPositions(positions));
+    }
+
+    for (size_t i = 0; i < term_ids.size(); ++i) {
+        postings_[term_ids[i]].Insert(document_id, term_freqs[i], status, options_.bitmap_postings_min_documents);
+    }
+    if (options_.impact_ordered_postings) {
+        const int rating = it->second.rating;
+        for (size_t i = 0; i < term_ids.size(); ++i) {
+            impact_postings_[term_ids[i]].push_back({document_id, term_freqs[i], rating, status});
+        }
     }
+    for (size_t i = 0; i < term_ids.size() && !hot_terms_.empty(); ++i) {
+        const auto hot_term = hot_terms_.find(term_ids[i]);
+        if (hot_term != hot_terms_.end()) {
+            (*hot_term->second)[static_cast<size_t>(status)].Insert({document_id, term_freqs[i], it->second.rating});
+        }
+    }
+    ++generation_;
+    MatchStandingQueries(document_id, status, term_ids, term_freqs, document_word_freqs);
 
 }
 
-SearchServer:: SearchServer( string_view stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer:: SearchServer( string_view stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text), options) {
 
 }
 
-SearchServer:: SearchServer(const string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer:: SearchServer(const string& stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text), options) {
 
 }
 
 vector<Document> SearchServer:: FindTopDocuments(const std::execution::sequenced_policy&, string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq,raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments(std::execution::seq, raw_query, status, QueryControl{}).documents;
 }
 
 vector<Document> SearchServer:: FindTopDocuments( string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq,raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments<DocumentStatus>(raw_query, status);
 }
 vector<Document> SearchServer:: FindTopDocuments(const std::execution::parallel_policy&, string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::par,raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+    return FindTopDocuments(std::execution::par, raw_query, status, QueryControl{}).documents;
 }
 vector<Document>  SearchServer:: FindTopDocuments(string_view raw_query) const {
-    return FindTopDocuments( std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 vector<Document>  SearchServer:: FindTopDocuments(const std::execution::sequenced_policy&,string_view raw_query)const {
     return FindTopDocuments( std::execution::seq, raw_query, DocumentStatus::ACTUAL);
@@ -56,6 +130,36 @@ vector<Document>  SearchServer:: FindTopDocuments(const std::execution::parallel
     return FindTopDocuments( std::execution::par, raw_query, DocumentStatus::ACTUAL);
 }
 
+ExecutionPlan SearchServer:: PlanQueries(const vector<string>& queries) const {
+    if (queries.size() < 2) {
+        return ExecutionPlan::SEQUENTIAL;
+    }
+    size_t work = 0;
+    for (const string& query : queries) {
+        work += EstimateQueryWork(ResolveQueryTerms(ParseQuery(query)), DocumentStatus::ACTUAL);
+        if (work >= cost_model_.parallel_min_work) {
+            return ExecutionPlan::BATCHED;
+        }
+    }
+    return ExecutionPlan::SEQUENTIAL;
+}
+
+future<SearchResult> SearchServer:: FindTopDocumentsAsync(string_view raw_query, DocumentStatus status, QueryControl control) const {
+    return FindTopDocumentsAsync<DocumentStatus>(raw_query, status, control);
+}
+
+future<SearchResult> SearchServer:: FindTopDocumentsAsync(string_view raw_query, QueryControl control) const {
+    return FindTopDocumentsAsync(raw_query, DocumentStatus::ACTUAL, control);
+}
+
+SearchPage SearchServer:: FindNextDocuments(string_view raw_query, DocumentStatus status, const SearchCursor& after, size_t page_size) const {
+    return FindNextDocuments(std::execution::seq, raw_query, status, after, page_size);
+}
+
+SearchPage SearchServer:: FindNextDocuments(string_view raw_query, const SearchCursor& after, size_t page_size) const {
+    return FindNextDocuments(raw_query, DocumentStatus::ACTUAL, after, page_size);
+}
+
 int  SearchServer:: GetDocumentCount() const {
     return documents_.size();
 }
@@ -69,68 +173,160 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     if (!document_ids_.count(document_id)) {
         throw std::out_of_range("incorrect document_id");
     }
-    const Query query = ParseQuery(raw_query);
+    return MatchDocumentTerms(ResolveQueryTerms(ParseQuery(raw_query)), document_id);
+}
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+// Один документ сопоставляется с запросом быстрее, чем запускаются потоки,
+// поэтому параллельная версия использует тот же последовательный алгоритм
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+// Каждый документ сопоставляется со всеми словами запроса, поэтому работа пакета -
+// число документов, умноженное на число слов
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+    const QueryTermIds query_terms = ResolveQueryTerms(ParseQuery(raw_query));
+    const size_t work = document_ids.size() * (query_terms.plus_ids.size() + query_terms.minus_ids.size()) * MATCH_WORK_PER_TERM;
+    if (work >= cost_model_.parallel_min_work) {
+        return MatchDocumentTerms(std::execution::par, query_terms, document_ids);
+    }
+    return MatchDocumentTerms(std::execution::seq, query_terms, document_ids);
+}
+
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::sequenced_policy&, string_view raw_query,
+                                                                                const vector<int>& document_ids) const {
+    return MatchDocumentTerms(std::execution::seq, ResolveQueryTerms(ParseQuery(raw_query)), document_ids);
+}
+
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::parallel_policy&, string_view raw_query,
+                                                                                const vector<int>& document_ids) const {
+    return MatchDocumentTerms(std::execution::par, ResolveQueryTerms(ParseQuery(raw_query)), document_ids);
+}
+
+template <typename ExecutionPolicy>
+vector<tuple<vector<string_view>, DocumentStatus>> SearchServer::MatchDocumentTerms(ExecutionPolicy&& police, const QueryTermIds& query_terms,
+                                                                                    const vector<int>& document_ids) const {
+    vector<tuple<vector<string_view>, DocumentStatus>> result;
+    if constexpr (is_same_v<decay_t<ExecutionPolicy>, execution::sequenced_policy>) {
+        result.reserve(document_ids.size());
+        for (const int document_id : document_ids) {
+            result.push_back(MatchDocumentTerms(query_terms, document_id));
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { vector<std::string_view>{}, documents_.at(document_id).status };
+    } else {
+        // исключение из параллельного алгоритма завершило бы программу, поэтому оно
+        // перехватывается в потоке и бросается заново после обхода
+        atomic_bool has_invalid_id = false;
+        result.resize(document_ids.size());
+        transform(police, document_ids.begin(), document_ids.end(), result.begin(),
+                  [this, &query_terms, &has_invalid_id](int document_id) {
+            try {
+                return MatchDocumentTerms(query_terms, document_id);
+            } catch (const out_of_range&) {
+                has_invalid_id = true;
+                return tuple<vector<string_view>, DocumentStatus>{};
+            }
+        });
+        if (has_invalid_id) {
+            throw out_of_range("incorrect document_id");
         }
     }
-    std::vector<std::string_view> matched_words;
+    return result;
+}
 
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+SearchServer::QueryTermIds SearchServer::ResolveQueryTerms(const Query& query) const {
+    QueryTermIds result;
+    for (const auto& [words, ids] : { pair{&query.plus_words, &result.plus_ids}, pair{&query.minus_words, &result.minus_ids} }) {
+        ids->reserve(words->size());
+        for (const string_view word : *words) {
+            const int term_id = FindTermId(word);
+            if (term_id >= 0 && postings_[term_id].document_count > 0) {
+                ids->push_back(term_id);
+            }
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        sort(ids->begin(), ids->end());
+        ids->erase(unique(ids->begin(), ids->end()), ids->end());
+    }
+    for (const auto& phrase : query.phrases) {
+        vector<int>& phrase_ids = result.phrase_ids.emplace_back();
+        for (const string_view word : phrase) {
+            const int term_id = FindTermId(word);
+            phrase_ids.push_back(term_id >= 0 && postings_[term_id].document_count > 0 ? term_id : -1);
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return result;
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query, true);
-
-    const auto status = documents_.at(document_id).status;
-
-    const auto whoareyou =
-            [this, document_id](const std::string_view word) {
-        const auto it = word_to_document_freqs_.find(word);
-        return it != word_to_document_freqs_.end() && it->second.count(document_id);
-    };
-
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), whoareyou )) {
-        return {vector<std::string_view> {}, status };
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocumentTerms(const QueryTermIds& query_terms, int document_id) const {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        throw std::out_of_range("incorrect document_id");
     }
+    const DocumentStatus status = document_it->second.status;
+    const vector<int>& document_terms = document_terms_.at(document_id);
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-                                  matched_words.begin(), whoareyou
-                                  );
-    std::sort(matched_words.begin(), words_end);
-    words_end = std::unique(matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+    bool has_minus_word = false;
+    IntersectSorted(query_terms.minus_ids.begin(), query_terms.minus_ids.end(), document_terms.begin(), document_terms.end(),
+                    [&has_minus_word](int) { has_minus_word = true; });
+    if (has_minus_word || (UsesPositions(query_terms) && ComputePositionalFactor(query_terms, document_id) == 0.0)) {
+        return { vector<string_view>{}, status };
+    }
 
+    vector<string_view> matched_words;
+    IntersectSorted(query_terms.plus_ids.begin(), query_terms.plus_ids.end(), document_terms.begin(), document_terms.end(),
+                    [this, &matched_words](int term_id) { matched_words.push_back(terms_[term_id]); });
+    sort(matched_words.begin(), matched_words.end());
     return { matched_words, status };
 }
 
+// При позиционном индексе слова в кавычках образуют фразу: "curly cat". Фразы из одного слова
+// считаются обычными словами. Без позиционного индекса кавычки - часть слова, как до появления фраз.
+// Слово с * на конце заменяется словами индекса с таким префиксом: cat* или -cat*.
 Query SearchServer::ParseQuery(const std::string_view text, bool no_sort) const {
     Query result;
-    for (const std::string_view word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+    bool in_phrase = false;
+    for (std::string_view word : SplitIntoWords(text)) {
+        if (options_.positional_index && !in_phrase && word.front() == '"') {
+            word.remove_prefix(1);
+            result.phrases.emplace_back();
+            in_phrase = true;
+        }
+        bool phrase_end = false;
+        if (in_phrase && !word.empty() && word.back() == '"') {
+            word.remove_suffix(1);
+            phrase_end = true;
+        }
+        if (!word.empty()) {
+            const auto query_word = ParseQueryWord(word);
+            if (in_phrase && (query_word.is_minus || query_word.is_prefix)) {
+                throw invalid_argument("Query "s + string(text) + " has minus or prefix word inside phrase"s);
             }
-            else {
-                result.plus_words.push_back(query_word.data);
+            if (query_word.is_prefix) {
+                auto& words = query_word.is_minus ? result.minus_words : result.plus_words;
+                for (const string_view term : ExpandPrefix(query_word.data)) {
+                    words.push_back(term);
+                }
+            } else if (!query_word.is_stop) {
+                if (query_word.is_minus) {
+                    result.minus_words.push_back(query_word.data);
+                }
+                else {
+                    result.plus_words.push_back(query_word.data);
+                    if (in_phrase) {
+                        result.phrases.back().push_back(query_word.data);
+                    }
+                }
             }
         }
+        if (phrase_end) {
+            in_phrase = false;
+        }
+    }
+    if (in_phrase) {
+        throw invalid_argument("Query "s + string(text) + " has unclosed quote"s);
     }
+    result.phrases.erase(remove_if(result.phrases.begin(), result.phrases.end(),
+                                   [](const vector<string_view>& phrase) { return phrase.size() < 2; }),
+                         result.phrases.end());
     if (!no_sort) {
         for (auto* words : { &result.plus_words, &result.minus_words }) {
             std::sort(words->begin(), words->end());
@@ -165,60 +361,152 @@ set<int>::const_iterator SearchServer::end() const
 
 }
 
+// Все версии удаления работают за O(длины документа): документ помечается удалённым,
+// а списки документов его слов очищаются позже одним параллельным проходом.
 void SearchServer::RemoveDocument(int document_id)
 {
-    set<int>::iterator it = document_ids_.find(document_id);
-
-    if(it == document_ids_.end()){
+    if (documents_.count(document_id) == 0) {
         return;
     }
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendRemove(document_id);
+    }
+    MarkDocumentRemoved(document_id);
+    PurgeIfNeeded();
+}
 
-    documents_.erase(document_id);
+void SearchServer::RemoveDocument(const execution::parallel_policy&, int document_id) {
+    RemoveDocument(document_id);
+}
 
-    for(auto & [word,doc_id]:document_to_word_freqs_[document_id]){
+void SearchServer::RemoveDocument(const execution::sequenced_policy&, int document_id) {
+    RemoveDocument(document_id);
+}
 
-        word_to_document_freqs_[word].erase(document_id);
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    vector<int> existing_ids;
+    existing_ids.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        if (documents_.count(document_id) > 0) {
+            existing_ids.push_back(document_id);
+        }
     }
-
-    document_to_word_freqs_.erase(document_id);
-    docs_duplecats.erase(document_id);
-    document_ids_.erase(it);
-
+    sort(existing_ids.begin(), existing_ids.end());
+    existing_ids.erase(unique(existing_ids.begin(), existing_ids.end()), existing_ids.end());
+    if (existing_ids.empty()) {
+        return;
+    }
+    // пакет попадает в журнал целиком до первого изменения: при ошибке не удалён ни один документ
+    if (write_ahead_log_) {
+        write_ahead_log_->AppendRemoves(existing_ids);
+    }
+    for (const int document_id : existing_ids) {
+        MarkDocumentRemoved(document_id);
+    }
+    PurgeIfNeeded();
 }
-void SearchServer::RemoveDocument(const execution::parallel_policy&, int document_id) {
-    if (document_to_word_freqs_.count(document_id) == 0) {
+
+void SearchServer::PurgeRemovedDocuments() {
+    if (pending_removed_ids_.empty()) {
         return;
     }
+    sort(dirty_term_ids_.begin(), dirty_term_ids_.end());
+    dirty_term_ids_.erase(unique(dirty_term_ids_.begin(), dirty_term_ids_.end()), dirty_term_ids_.end());
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    mutex freqs_mutex;
-
-    const auto& word_freqs = document_to_word_freqs_.at(document_id);
-    for_each(execution::par, word_freqs.begin(), word_freqs.end(),
-        [this, document_id,&freqs_mutex](const auto& item) {
-        lock_guard guard(freqs_mutex);
-        word_to_document_freqs_.at(item.first).erase(document_id);
+    for_each(execution::par, dirty_term_ids_.begin(), dirty_term_ids_.end(), [this](int term_id) {
+        PostingList& postings = postings_[term_id];
+        if (postings.document_count == 0) {
+            postings = PostingList{};
+            impact_postings_[term_id] = {};
+            impact_sorted_sizes_[term_id] = 0;
+        } else {
+            postings.Purge(removed_documents_, options_.bitmap_postings_min_documents);
+            SortImpactPostings(term_id);
+            auto& impact_postings = impact_postings_[term_id];
+            impact_postings.erase(remove_if(impact_postings.begin(), impact_postings.end(), [this](const ImpactEntry& entry) {
+                return IsDocumentRemoved(entry.document_id);
+            }), impact_postings.end());
+            impact_sorted_sizes_[term_id] = impact_postings.size();
+        }
     });
 
-    document_to_word_freqs_.erase(document_id);
+    // слова, которых не осталось ни в одном документе, удаляются из словаря
+    bool terms_removed = false;
+    for (const int term_id : dirty_term_ids_) {
+        if (postings_[term_id].document_count == 0) {
+            term_to_id_.erase(terms_[term_id]);
+            string().swap(terms_[term_id]);
+            hot_terms_.erase(term_id);
+            term_query_counts_[term_id] = 0;
+            term_standing_triggers_[term_id] = nullptr;
+            free_term_ids_.push_back(term_id);
+            term_dictionary_.reset();
+            terms_removed = true;
+        }
+    }
+    // из фильтра Блума слова не удалить, поэтому он строится заново
+    if (terms_removed) {
+        RebuildTermFilter();
+    }
+
+    for (const int document_id : pending_removed_ids_) {
+        removed_documents_[document_id] = false;
+    }
+    pending_removed_ids_.clear();
+    dirty_term_ids_.clear();
 }
 
-void SearchServer::RemoveDocument(const execution::sequenced_policy&, int document_id) {
-    if (document_to_word_freqs_.count(document_id) == 0) {
-        return;
+bool SearchServer::MarkDocumentRemoved(int document_id) {
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return false;
+    }
+    for (const int term_id : document_terms_.at(document_id)) {
+        --postings_[term_id].document_count;
+        dirty_term_ids_.push_back(term_id);
     }
+    const vector<int> drained_term_ids = hot_terms_.empty()
+                                             ? vector<int>{}
+                                             : RemoveFromHotTerms(document_id, it->second.status, document_terms_.at(document_id));
 
+    status_documents_[static_cast<size_t>(it->second.status)].Remove(static_cast<uint32_t>(document_id));
+    documents_.erase(it);
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    document_to_word_freqs_.erase(document_id);
+    document_terms_.erase(document_id);
+    document_positions_.erase(document_id);
+    docs_duplecats.erase(document_id);
 
-    const auto& word_freqs = document_to_word_freqs_.at(document_id);
-    for_each(execution::seq, word_freqs.begin(), word_freqs.end(),
-             [this, document_id](const auto& item) {
-        word_to_document_freqs_.at(item.first).erase(document_id);
-    });
+    if (removed_documents_.size() <= static_cast<size_t>(document_id)) {
+        removed_documents_.resize(static_cast<size_t>(document_id) + 1);
+    }
+    removed_documents_[document_id] = true;
+    pending_removed_ids_.push_back(document_id);
+    for (const int term_id : drained_term_ids) {
+        *hot_terms_.at(term_id) = BuildHotTermLists(term_id);
+    }
+    ++generation_;
+    return true;
+}
 
-    document_to_word_freqs_.erase(document_id);
+void SearchServer::PurgeIfNeeded() {
+    const size_t threshold = max(PURGE_MIN_REMOVED_DOCUMENTS, documents_.size() / PURGE_LIVE_DOCUMENTS_RATIO);
+    if (pending_removed_ids_.size() >= threshold) {
+        PurgeRemovedDocuments();
+    }
+}
+
+void SearchServer::DropRemovedDocuments(ScoredDocuments& scored) const {
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        if (!IsDocumentRemoved(scored.ids[i])) {
+            scored.ids[kept] = scored.ids[i];
+            scored.relevances[kept] = scored.relevances[i];
+            ++kept;
+        }
+    }
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
 }
 
 map<int,set<string>> SearchServer::GetDocsDuplicate()
@@ -227,7 +515,7 @@ map<int,set<string>> SearchServer::GetDocsDuplicate()
 }
 
 bool SearchServer:: IsStopWord(const string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer:: IsValidWord(const string_view word) {
@@ -268,41 +556,844 @@ QueryWord  SearchServer:: ParseQueryWord(string_view text) const {
         is_minus = true;
         word = word.substr(1);
     }
+    bool is_prefix = false;
+    if (!word.empty() && word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
+    }
     if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
         throw invalid_argument("Query word "s + string(text) + " is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, !is_prefix && IsStopWord(word), is_prefix};
 }
 
 
 Query  SearchServer:: ParseQuery(string_view text) const {
-    Query result;
+    return ParseQuery(text, false);
+}
 
-    for (auto word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+
+int SearchServer:: GetOrAddTermId(string_view word) {
+    if (term_filter_.MayContain(word)) {
+        const auto it = term_to_id_.find(word);
+        if (it != term_to_id_.end()) {
+            return it->second;
+        }
+    }
+    int term_id;
+    if (!free_term_ids_.empty()) {
+        term_id = free_term_ids_.back();
+        free_term_ids_.pop_back();
+        terms_[term_id] = string(word);
+    } else {
+        term_id = static_cast<int>(terms_.size());
+        terms_.emplace_back(word);
+        postings_.emplace_back();
+        impact_postings_.emplace_back();
+        impact_sorted_sizes_.emplace_back(0);
+        term_query_counts_.emplace_back(0);
+        term_standing_triggers_.emplace_back();
+    }
+    if (standing_queries_.GetQueryCount() > 0) {
+        term_standing_triggers_[term_id] = standing_queries_.FindTriggers(word);
+    }
+    term_to_id_.emplace(terms_[term_id], term_id);
+    if (term_to_id_.size() > term_filter_.GetCapacity()) {
+        RebuildTermFilter();
+    } else {
+        term_filter_.Add(word);
+    }
+    term_dictionary_.reset();
+    return term_id;
+}
+
+int SearchServer:: FindTermId(string_view word) const {
+    if (!term_filter_.MayContain(word)) {
+        return -1;
+    }
+    const auto it = term_to_id_.find(word);
+    return it != term_to_id_.end() ? it->second : -1;
+}
+
+// Фильтр строится с двукратным запасом, чтобы перестраивать его при росте словаря редко
+void SearchServer:: RebuildTermFilter() {
+    term_filter_ = BloomFilter(max<size_t>(MIN_TERM_FILTER_CAPACITY, term_to_id_.size() * 2));
+    for (const auto& [term, term_id] : term_to_id_) {
+        term_filter_.Add(term);
+    }
+}
+
+double SearchServer:: ComputeTermInverseDocumentFreq(int term_id) const {
+    return log(GetDocumentCount() * 1.0 / postings_[term_id].document_count);
+}
+
+QueryExecutor& SearchServer:: GetExecutor() const {
+    call_once(executor_once_, [this] {
+        executor_ = make_unique<QueryExecutor>(options_.executor_threads);
+    });
+    return *executor_;
+}
+
+bool SearchServer::PostingList::Contains(int document_id) const {
+    if (is_bitmap) {
+        return bitmap.Contains(static_cast<uint32_t>(document_id));
+    }
+    return binary_search(document_ids.begin(), document_ids.end(), document_id);
+}
+
+double SearchServer::PostingList::GetTermFreq(int document_id) const {
+    if (is_bitmap) {
+        return bitmap.Contains(static_cast<uint32_t>(document_id)) ? term_freqs[bitmap.Rank(static_cast<uint32_t>(document_id))] : 0.0;
+    }
+    const auto it = lower_bound(document_ids.begin(), document_ids.end(), document_id);
+    if (it == document_ids.end() || *it != document_id) {
+        return 0.0;
+    }
+    return term_freqs[it - document_ids.begin()];
+}
+
+void SearchServer::PostingList::Insert(int document_id, double term_freq, DocumentStatus status, size_t bitmap_min_documents) {
+    // id обычно растут, поэтому почти всегда это вставка в конец
+    size_t pos = 0;
+    if (is_bitmap) {
+        pos = bitmap.Rank(static_cast<uint32_t>(document_id));
+        bitmap.Add(static_cast<uint32_t>(document_id));
+    } else {
+        pos = lower_bound(document_ids.begin(), document_ids.end(), document_id) - document_ids.begin();
+        document_ids.insert(document_ids.begin() + pos, document_id);
+    }
+    term_freqs.insert(term_freqs.begin() + pos, term_freq);
+    statuses.insert(statuses.begin() + pos, status);
+    ++document_count;
+
+    if (!is_bitmap && bitmap_min_documents != 0 && document_ids.size() >= bitmap_min_documents) {
+        bitmap = RoaringBitmap(document_ids.data(), document_ids.data() + document_ids.size());
+        vector<int>().swap(document_ids);
+        is_bitmap = true;
+    }
+}
+
+void SearchServer::PostingList::Purge(const vector<bool>& removed_documents, size_t bitmap_min_documents) {
+    const auto is_removed = [&removed_documents](int document_id) {
+        return static_cast<size_t>(document_id) < removed_documents.size() && removed_documents[document_id];
+    };
+    size_t kept = 0;
+    if (is_bitmap) {
+        vector<int> kept_ids(GetSize());
+        bitmap.Decode(kept_ids.data());
+        for (size_t i = 0; i < kept_ids.size(); ++i) {
+            if (is_removed(kept_ids[i])) {
+                continue;
+            }
+            kept_ids[kept] = kept_ids[i];
+            term_freqs[kept] = term_freqs[i];
+            statuses[kept] = statuses[i];
+            ++kept;
+        }
+        kept_ids.resize(kept);
+        // с запасом до порога, чтобы список не переходил туда и обратно при каждой очистке
+        if (kept * 2 < bitmap_min_documents) {
+            bitmap = RoaringBitmap{};
+            document_ids = move(kept_ids);
+            is_bitmap = false;
+        } else {
+            bitmap = RoaringBitmap(kept_ids.data(), kept_ids.data() + kept_ids.size());
+        }
+    } else {
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            if (is_removed(document_ids[i])) {
+                continue;
+            }
+            document_ids[kept] = document_ids[i];
+            term_freqs[kept] = term_freqs[i];
+            statuses[kept] = statuses[i];
+            ++kept;
+        }
+        document_ids.resize(kept);
+    }
+    term_freqs.resize(kept);
+    statuses.resize(kept);
+}
+
+// Фильтр по статусу для списка в битовой карте: пересечение с документами статуса
+// по 64 id за операцию, документы другого статуса не читаются вовсе
+bool SearchServer::ScoreBitmapPostings(const PostingList& postings, double inverse_document_freq, DocumentStatus status,
+                                       const QueryControl& control, ScoredDocuments& scored) const {
+    const RoaringBitmap& status_documents = status_documents_[static_cast<size_t>(status)];
+    const size_t max_count = min(postings.GetSize(), status_documents.GetCardinality());
+    scored.ids.resize(max_count);
+    scored.relevances.resize(max_count);
+    const double* term_freqs = postings.term_freqs.data();
+    int* out_ids = scored.ids.data();
+    double* out_relevances = scored.relevances.data();
+    const bool completed = postings.bitmap.ForEachAnd(status_documents, [&](uint32_t document_id, size_t rank) {
+        *out_ids++ = static_cast<int>(document_id);
+        *out_relevances++ = term_freqs[rank] * inverse_document_freq;
+    }, [&control] {
+        return control.IsExpired();
+    });
+    const size_t matched = out_ids - scored.ids.data();
+    scored.ids.resize(matched);
+    scored.relevances.resize(matched);
+    return completed;
+}
+
+void SearchServer:: MergeScores(ScoredDocuments& accumulated, ScoredDocuments& addition) {
+    if (accumulated.ids.empty()) {
+        swap(accumulated, addition);
+        return;
+    }
+    if (addition.ids.empty()) {
+        return;
+    }
+    ScoredDocuments merged;
+    merged.ids.reserve(accumulated.ids.size() + addition.ids.size());
+    merged.relevances.reserve(accumulated.ids.size() + addition.ids.size());
+    size_t lhs = 0;
+    size_t rhs = 0;
+    while (lhs < accumulated.ids.size() && rhs < addition.ids.size()) {
+        if (accumulated.ids[lhs] < addition.ids[rhs]) {
+            merged.ids.push_back(accumulated.ids[lhs]);
+            merged.relevances.push_back(accumulated.relevances[lhs++]);
+        } else if (addition.ids[rhs] < accumulated.ids[lhs]) {
+            merged.ids.push_back(addition.ids[rhs]);
+            merged.relevances.push_back(addition.relevances[rhs++]);
+        } else {
+            merged.ids.push_back(accumulated.ids[lhs]);
+            merged.relevances.push_back(accumulated.relevances[lhs++] + addition.relevances[rhs++]);
+        }
+    }
+    merged.ids.insert(merged.ids.end(), accumulated.ids.begin() + lhs, accumulated.ids.end());
+    merged.relevances.insert(merged.relevances.end(), accumulated.relevances.begin() + lhs, accumulated.relevances.end());
+    merged.ids.insert(merged.ids.end(), addition.ids.begin() + rhs, addition.ids.end());
+    merged.relevances.insert(merged.relevances.end(), addition.relevances.begin() + rhs, addition.relevances.end());
+    accumulated = move(merged);
+}
+
+void SearchServer:: ExcludeDocuments(ScoredDocuments& scored, const vector<int>& excluded_ids) {
+    auto excluded = excluded_ids.begin();
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        excluded = GallopingLowerBound(excluded, excluded_ids.end(), scored.ids[i]);
+        if (excluded != excluded_ids.end() && *excluded == scored.ids[i]) {
+            continue;
+        }
+        scored.ids[kept] = scored.ids[i];
+        scored.relevances[kept] = scored.relevances[i];
+        ++kept;
+    }
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
+}
+
+void SearchServer:: IntersectDocuments(ScoredDocuments& scored, const vector<int>& document_ids) {
+    auto it = document_ids.begin();
+    KeepDocuments(scored, [&it, &document_ids](int document_id) {
+        it = GallopingLowerBound(it, document_ids.end(), document_id);
+        return it != document_ids.end() && *it == document_id;
+    });
+}
+
+bool SearchServer::UsesPositions(const QueryTermIds& query_terms) const {
+    return options_.positional_index && (!query_terms.phrase_ids.empty() || query_terms.plus_ids.size() > 1);
+}
+
+// Множитель релевантности документа: 0, если в нём нет какой-то из фраз запроса,
+// иначе 1 + PROXIMITY_WEIGHT / (наименьшее расстояние между разными словами запроса)
+double SearchServer::ComputePositionalFactor(const QueryTermIds& query_terms, int document_id) const {
+    const vector<int>& document_terms = document_terms_.at(document_id);
+    vector<int> present_terms;
+    IntersectSorted(query_terms.plus_ids.begin(), query_terms.plus_ids.end(), document_terms.begin(), document_terms.end(),
+                    [&present_terms](int term_id) { present_terms.push_back(term_id); });
+    // без фраз и с одним словом запроса в документе позиции не нужны
+    if (query_terms.phrase_ids.empty() && present_terms.size() < 2) {
+        return 1.0;
+    }
+
+    const DocumentPositions& positions = document_positions_.at(document_id);
+    const auto get_positions = [&document_terms, &positions](int term_id) {
+        const auto it = lower_bound(document_terms.begin(), document_terms.end(), term_id);
+        if (it == document_terms.end() || *it != term_id) {
+            return vector<uint32_t>{};
+        }
+        return positions.GetPositions(it - document_terms.begin());
+    };
+
+    vector<vector<uint32_t>> term_positions;
+    for (const auto& phrase : query_terms.phrase_ids) {
+        term_positions.clear();
+        for (const int term_id : phrase) {
+            term_positions.push_back(term_id < 0 ? vector<uint32_t>{} : get_positions(term_id));
+            if (term_positions.back().empty()) {
+                return 0.0;
+            }
+        }
+        if (!ContainsPhrase(term_positions)) {
+            return 0.0;
+        }
+    }
+
+    term_positions.clear();
+    for (const int term_id : present_terms) {
+        term_positions.push_back(get_positions(term_id));
+    }
+    const uint32_t distance = ComputeMinimalDistance(term_positions);
+    return distance == 0 ? 1.0 : 1.0 + PROXIMITY_WEIGHT / distance;
+}
+
+void SearchServer::ApplyPositionalFactors(const std::execution::sequenced_policy&, const QueryTermIds& query_terms, ScoredDocuments& scored) const {
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        const double factor = ComputePositionalFactor(query_terms, scored.ids[i]);
+        // нулевой множитель - в документе нет фразы запроса
+        if (factor != 0.0) {
+            scored.ids[kept] = scored.ids[i];
+            scored.relevances[kept] = scored.relevances[i] * factor;
+            ++kept;
+        }
+    }
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
+}
+
+void SearchServer::ApplyPositionalFactors(const std::execution::parallel_policy&, const QueryTermIds& query_terms, ScoredDocuments& scored) const {
+    vector<double> factors(scored.ids.size());
+    transform(execution::par, scored.ids.begin(), scored.ids.end(), factors.begin(), [this, &query_terms](int document_id) {
+        return ComputePositionalFactor(query_terms, document_id);
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        if (factors[i] != 0.0) {
+            scored.ids[kept] = scored.ids[i];
+            scored.relevances[kept] = scored.relevances[i] * factors[i];
+            ++kept;
+        }
+    }
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const {
+    size_t memory = postings_.capacity() * sizeof(PostingList);
+    for (const PostingList& postings : postings_) {
+        memory += postings.document_ids.capacity() * sizeof(int) + postings.bitmap.GetMemoryUsage()
+                  + postings.term_freqs.capacity() * sizeof(double) + postings.statuses.capacity() * sizeof(DocumentStatus);
+    }
+    return memory;
+}
+
+size_t SearchServer::GetPositionalIndexMemoryUsage() const {
+    size_t memory = 0;
+    for (const auto& [document_id, positions] : document_positions_) {
+        memory += positions.GetMemoryUsage();
+    }
+    return memory;
+}
+
+// Слияние k отсортированных по id списков через кучу: O(N log k) вместо O(N k) при попарном слиянии
+SearchServer::ScoredDocuments SearchServer:: MergeAllScores(vector<ScoredDocuments>& term_scores) {
+    ScoredDocuments accumulated;
+    if (term_scores.size() <= 2) {
+        for (ScoredDocuments& scored : term_scores) {
+            MergeScores(accumulated, scored);
+        }
+        return accumulated;
+    }
+
+    size_t total = 0;
+    vector<pair<int, size_t>> heap;
+    for (size_t list = 0; list < term_scores.size(); ++list) {
+        total += term_scores[list].ids.size();
+        if (!term_scores[list].ids.empty()) {
+            heap.emplace_back(term_scores[list].ids[0], list);
+        }
+    }
+    accumulated.ids.reserve(total);
+    accumulated.relevances.reserve(total);
+    const auto greater_id = [](const pair<int, size_t>& lhs, const pair<int, size_t>& rhs) {
+        return lhs.first > rhs.first;
+    };
+    make_heap(heap.begin(), heap.end(), greater_id);
+    vector<size_t> positions(term_scores.size(), 0);
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), greater_id);
+        const auto [document_id, list] = heap.back();
+        const double relevance = term_scores[list].relevances[positions[list]];
+        if (!accumulated.ids.empty() && accumulated.ids.back() == document_id) {
+            accumulated.relevances.back() += relevance;
+        } else {
+            accumulated.ids.push_back(document_id);
+            accumulated.relevances.push_back(relevance);
+        }
+        if (++positions[list] < term_scores[list].ids.size()) {
+            heap.back().first = term_scores[list].ids[positions[list]];
+            push_heap(heap.begin(), heap.end(), greater_id);
+        } else {
+            heap.pop_back();
+        }
+    }
+    return accumulated;
+}
+
+// Массивы id минус-слов вычитаются слиянием; битовые карты вычитаются из карты кандидатов
+// по контейнерам, без поиска каждого кандидата в каждой карте
+void SearchServer::ExcludeTermDocuments(const vector<int>& term_ids, ScoredDocuments& scored) const {
+    RoaringBitmap candidates;
+    bool has_bitmap_terms = false;
+    for (const int term_id : term_ids) {
+        const PostingList& postings = postings_[term_id];
+        if (!postings.is_bitmap) {
+            ExcludeDocuments(scored, postings.document_ids);
+            continue;
+        }
+        if (!has_bitmap_terms) {
+            candidates = RoaringBitmap(scored.ids.data(), scored.ids.data() + scored.ids.size());
+            has_bitmap_terms = true;
+        }
+        candidates.AndNot(postings.bitmap);
+    }
+    if (has_bitmap_terms) {
+        vector<int> kept_ids(candidates.GetCardinality());
+        candidates.Decode(kept_ids.data());
+        // кандидаты могли уменьшиться и слиянием после построения карты
+        auto kept_id = kept_ids.begin();
+        KeepDocuments(scored, [&kept_id, &kept_ids](int document_id) {
+            while (kept_id != kept_ids.end() && *kept_id < document_id) {
+                ++kept_id;
+            }
+            return kept_id != kept_ids.end() && *kept_id == document_id;
+        });
+    }
+}
+
+// Документ, в котором нет какого-то слова фразы, не содержит и самой фразы: такие
+// документы отсекаются пересечением со списками слов до чтения позиций
+void SearchServer::KeepPhraseDocuments(const QueryTermIds& query_terms, ScoredDocuments& scored) const {
+    for (const auto& phrase : query_terms.phrase_ids) {
+        for (const int term_id : phrase) {
+            if (term_id < 0) {
+                scored.ids.clear();
+                scored.relevances.clear();
+                return;
+            }
+            const PostingList& postings = postings_[term_id];
+            if (postings.is_bitmap) {
+                KeepDocuments(scored, [&postings](int document_id) {
+                    return postings.bitmap.Contains(static_cast<uint32_t>(document_id));
+                });
             } else {
-                result.plus_words.push_back(query_word.data);
+                IntersectDocuments(scored, postings.document_ids);
             }
         }
     }
+}
+
+shared_ptr<const TermDictionary> SearchServer::GetTermDictionary() const {
+    lock_guard guard(term_dictionary_mutex_);
+    if (!term_dictionary_) {
+        term_dictionary_ = make_shared<const TermDictionary>(term_to_id_);
+    }
+    return term_dictionary_;
+}
+
+vector<string_view> SearchServer::ExpandPrefix(string_view prefix) const {
+    vector<string_view> terms;
+    for (const int term_id : GetTermDictionary()->FindByPrefix(prefix, MAX_PREFIX_EXPANSION)) {
+        terms.push_back(terms_[term_id]);
+    }
+    return terms;
+}
 
-    sort(result.plus_words.begin(),result.plus_words.end());
-    auto last = std::unique(result.plus_words.begin(), result.plus_words.end());
-    result.plus_words.resize(std::distance(result.plus_words.begin(), last));
+bool SearchServer::HasHigherImpact(const ImpactEntry& lhs, const ImpactEntry& rhs) {
+    if (lhs.term_freq != rhs.term_freq) {
+        return lhs.term_freq > rhs.term_freq;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.document_id < rhs.document_id;
+}
 
+double SearchServer::GetTermFreq(int term_id, int document_id) const {
+    return postings_[term_id].GetTermFreq(document_id);
+}
 
-    sort(result.minus_words.begin(),result.minus_words.end());
-    auto last1 = std::unique(result.minus_words.begin(), result.minus_words.end());
-    result.minus_words.resize(std::distance(result.minus_words.begin(), last1));
+bool SearchServer::ContainsAnyTerm(const vector<int>& term_ids, int document_id) const {
+    return any_of(term_ids.begin(), term_ids.end(), [this, document_id](int term_id) {
+        return postings_[term_id].Contains(document_id);
+    });
+}
 
-    return result;
+shared_ptr<const SearchServer::HotTermLists> SearchServer::GetHotTermLists(int term_id) const {
+    const uint32_t query_count = term_query_counts_[term_id].fetch_add(1, memory_order_relaxed) + 1;
+    if (single_term_query_count_.fetch_add(1, memory_order_relaxed) % HOT_TERM_DECAY_INTERVAL == HOT_TERM_DECAY_INTERVAL - 1) {
+        // давние запросы постепенно перестают влиять на выбор горячих слов
+        for (auto& count : term_query_counts_) {
+            count.store(count.load(memory_order_relaxed) / 2, memory_order_relaxed);
+        }
+    }
+    const auto is_hotter = [this, query_count] {
+        return hot_terms_.size() < options_.hot_terms
+                || query_count > term_query_counts_[FindColdestHotTerm()].load(memory_order_relaxed);
+    };
+    {
+        lock_guard guard(hot_terms_mutex_);
+        const auto it = hot_terms_.find(term_id);
+        if (it != hot_terms_.end()) {
+            return it->second;
+        }
+        if (query_count < HOT_TERM_MIN_QUERIES
+                || static_cast<size_t>(postings_[term_id].document_count) < options_.hot_term_top_documents * HOT_TERM_MIN_DOCUMENTS_RATIO
+                || !is_hotter()) {
+            return nullptr;
+        }
+    }
+    // списки строятся без блокировки, другие запросы тем временем идут обычным путём
+    auto lists = make_shared<HotTermLists>(BuildHotTermLists(term_id));
+    lock_guard guard(hot_terms_mutex_);
+    const auto [it, inserted] = hot_terms_.emplace(term_id, nullptr);
+    if (!inserted) {
+        // то же слово успел сделать горячим другой запрос
+        return it->second;
+    }
+    if (hot_terms_.size() > options_.hot_terms) {
+        hot_terms_.erase(term_id);
+        if (!is_hotter()) {
+            return nullptr;
+        }
+        hot_terms_.erase(FindColdestHotTerm());
+        hot_terms_.emplace(term_id, lists);
+    } else {
+        it->second = lists;
+    }
+    return lists;
+}
+
+SearchServer::HotTermLists SearchServer::BuildHotTermLists(int term_id) const {
+    const PostingList& postings = postings_[term_id];
+    vector<int> decoded_ids;
+    if (postings.is_bitmap) {
+        decoded_ids.resize(postings.GetSize());
+        postings.bitmap.Decode(decoded_ids.data());
+    }
+    const vector<int>& document_ids = postings.is_bitmap ? decoded_ids : postings.document_ids;
+    array<vector<TopDocumentEntry>, 4> entries;
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        if (!IsDocumentRemoved(document_ids[i])) {
+            entries[static_cast<size_t>(postings.statuses[i])].push_back(
+                {document_ids[i], postings.term_freqs[i], documents_.at(document_ids[i]).rating});
+        }
+    }
+    HotTermLists lists;
+    for (size_t status = 0; status < lists.size(); ++status) {
+        lists[status] = TopDocumentList(options_.hot_term_top_documents);
+        lists[status].Build(move(entries[status]));
+    }
+    return lists;
 }
 
+int SearchServer::FindColdestHotTerm() const {
+    return min_element(hot_terms_.begin(), hot_terms_.end(), [this](const auto& lhs, const auto& rhs) {
+        return term_query_counts_[lhs.first].load(memory_order_relaxed) < term_query_counts_[rhs.first].load(memory_order_relaxed);
+    })->first;
+}
 
-double SearchServer:: ComputeWordInverseDocumentFreq( string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+// Документ уходит из списков горячих слов. Возвращает слова, списки которых после удалений
+// стали короче половины: их нужно построить заново, когда документ будет помечен удалённым.
+vector<int> SearchServer::RemoveFromHotTerms(int document_id, DocumentStatus status, const vector<int>& term_ids) {
+    vector<int> drained_term_ids;
+    for (const int term_id : term_ids) {
+        const auto hot_term = hot_terms_.find(term_id);
+        if (hot_term == hot_terms_.end()) {
+            continue;
+        }
+        TopDocumentList& list = (*hot_term->second)[static_cast<size_t>(status)];
+        if (list.Remove(document_id) && list.NeedsRebuild()) {
+            drained_term_ids.push_back(term_id);
+        }
+    }
+    return drained_term_ids;
+}
+
+void SearchServer::SortImpactPostings(int term_id) const {
+    auto& impact_postings = impact_postings_[term_id];
+    const auto sorted_end = impact_postings.begin() + impact_sorted_sizes_[term_id];
+    if (sorted_end == impact_postings.end()) {
+        return;
+    }
+    sort(sorted_end, impact_postings.end(), HasHigherImpact);
+    inplace_merge(impact_postings.begin(), sorted_end, impact_postings.end(), HasHigherImpact);
+    impact_sorted_sizes_[term_id] = impact_postings.size();
+}
+
+bool SearchServer::CanUseImpactOrder(const QueryTermIds& query_terms) const {
+    return options_.impact_ordered_postings && !query_terms.plus_ids.empty() && query_terms.plus_ids.size() <= 2
+            && !UsesPositions(query_terms);
+}
+
+bool SearchServer::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPS) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+bool SearchServer::IsAfterCursor(const Document& document, const SearchCursor& after) {
+    return after.is_start_ || IsRankedBefore({after.document_id_, after.relevance_, after.rating_}, document);
+}
+
+void SearchServer::DropDocumentsBeforeCursor(const SearchCursor& after, ScoredDocuments& scored) {
+    if (after.is_start_) {
+        return;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        if (scored.relevances[i] - after.relevance_ >= EPS) {
+            continue;
+        }
+        scored.ids[kept] = scored.ids[i];
+        scored.relevances[kept] = scored.relevances[i];
+        ++kept;
+    }
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
+}
+
+void SearchServer::KeepDocumentsAfter(const SearchCursor& after, vector<Document>& documents) {
+    if (after.is_start_) {
+        return;
+    }
+    documents.erase(remove_if(documents.begin(), documents.end(), [&after](const Document& document) {
+        return !IsAfterCursor(document, after);
+    }), documents.end());
+}
+
+int SearchServer::AddStandingQuery(string_view raw_query, DocumentStatus status) {
+    // слово с * раскрылось бы по текущему словарю и не учитывало бы слова будущих документов;
+    // внутри фраз такие слова отвергает ParseQuery
+    for (const string_view word : SplitIntoWords(raw_query)) {
+        if (word.back() == '*') {
+            throw invalid_argument("Standing query "s + string(raw_query) + " has prefix word"s);
+        }
+    }
+    const Query parsed = ParseQuery(raw_query);
+    if (parsed.plus_words.empty()) {
+        throw invalid_argument("Standing query "s + string(raw_query) + " has no plus words"s);
+    }
+    StandingQuery query{status, {}, {}, {}};
+    query.plus_words.assign(parsed.plus_words.begin(), parsed.plus_words.end());
+    query.minus_words.assign(parsed.minus_words.begin(), parsed.minus_words.end());
+    for (const auto& phrase : parsed.phrases) {
+        query.phrases.emplace_back(phrase.begin(), phrase.end());
+    }
+
+    // документ без фразы запросу не подходит, поэтому достаточно следить за одним её словом -
+    // тем, что реже всего встречается в индексе; иначе подходит документ с любым плюс-словом
+    vector<string> trigger_words;
+    if (options_.positional_index && !query.phrases.empty()) {
+        const auto get_document_count = [this](const string& word) {
+            const int term_id = FindTermId(word);
+            return term_id >= 0 ? postings_[term_id].document_count : 0;
+        };
+        const string* rarest_word = &query.phrases[0][0];
+        for (const auto& phrase : query.phrases) {
+            for (const string& word : phrase) {
+                if (get_document_count(word) < get_document_count(*rarest_word)) {
+                    rarest_word = &word;
+                }
+            }
+        }
+        trigger_words.push_back(*rarest_word);
+        query.has_single_trigger = true;
+    } else {
+        trigger_words = query.plus_words;
+    }
+
+    const bool has_only_plus_words = query.minus_words.empty() && query.phrases.empty();
+    const int query_id = standing_queries_.Add(move(query), trigger_words);
+    for (const string& word : trigger_words) {
+        const int term_id = FindTermId(word);
+        if (term_id >= 0) {
+            term_standing_triggers_[term_id] = standing_queries_.FindTriggers(word);
+        }
+    }
+    standing_query_scores_.resize(standing_queries_.GetQueryIdLimit());
+    standing_query_scores_[query_id].has_only_plus_words = has_only_plus_words;
+    return query_id;
+}
+
+void SearchServer::RemoveStandingQuery(int query_id) {
+    for (const string& word : standing_queries_.Remove(query_id)) {
+        const int term_id = FindTermId(word);
+        if (term_id >= 0) {
+            term_standing_triggers_[term_id] = nullptr;
+        }
+    }
+}
+
+size_t SearchServer::GetStandingQueryCount() const {
+    return standing_queries_.GetQueryCount();
+}
+
+void SearchServer::SetStandingQueryHandler(StandingQueryHandler handler) {
+    standing_query_handler_ = move(handler);
+}
+
+vector<StandingQueryMatch> SearchServer::TakeStandingQueryMatches() {
+    return exchange(standing_query_matches_, {});
+}
+
+// Релевантность запроса из одних слов копится по его словам в документе так же, как в
+// FindTopDocuments. Фразы и близость слов проверяются по позициям документа, а запросу с
+// одним триггером релевантность считается заново по всем его словам.
+void SearchServer::MatchStandingQueries(int document_id, DocumentStatus status, const vector<int>& term_ids,
+                                        const vector<double>& term_freqs, const map<string_view, double>& document_words) {
+    if (standing_queries_.GetQueryCount() == 0) {
+        return;
+    }
+    vector<int>& candidates = standing_query_candidates_;
+    for (size_t i = 0; i < term_ids.size(); ++i) {
+        const StandingQueryTriggers* triggers = term_standing_triggers_[term_ids[i]];
+        if (triggers == nullptr || (*triggers)[static_cast<size_t>(status)].empty()) {
+            continue;
+        }
+        const double relevance = term_freqs[i] * ComputeTermInverseDocumentFreq(term_ids[i]);
+        for (const int query_id : (*triggers)[static_cast<size_t>(status)]) {
+            StandingQueryScore& score = standing_query_scores_[query_id];
+            if (!score.is_candidate) {
+                score.is_candidate = true;
+                score.relevance = 0.0;
+                candidates.push_back(query_id);
+            }
+            score.relevance += relevance;
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    // без позиционного индекса запросу из одних плюс-слов достаточно быть кандидатом
+    const bool check_positions = options_.positional_index;
+    vector<StandingQueryMatch> matches;
+    matches.reserve(candidates.size());
+    for (const int query_id : candidates) {
+        StandingQueryScore& score = standing_query_scores_[query_id];
+        score.is_candidate = false;
+        if (!check_positions && score.has_only_plus_words) {
+            matches.push_back({query_id, document_id, score.relevance});
+            continue;
+        }
+        const StandingQuery& query = *standing_queries_.Find(query_id);
+        if (any_of(query.minus_words.begin(), query.minus_words.end(), [&document_words](const string& word) {
+            return document_words.count(word) > 0;
+        })) {
+            continue;
+        }
+        double relevance = score.relevance;
+        if (check_positions && (query.plus_words.size() > 1 || !query.phrases.empty())) {
+            const QueryTermIds query_terms = ResolveStandingQuery(query);
+            const double factor = ComputePositionalFactor(query_terms, document_id);
+            if (factor == 0.0) {
+                continue;
+            }
+            if (query.has_single_trigger) {
+                relevance = 0.0;
+                for (const int term_id : query_terms.plus_ids) {
+                    relevance += GetTermFreq(term_id, document_id) * ComputeTermInverseDocumentFreq(term_id);
+                }
+            }
+            relevance *= factor;
+        }
+        matches.push_back({query_id, document_id, relevance});
+    }
+    candidates.clear();
+
+    for (const StandingQueryMatch& match : matches) {
+        if (standing_query_handler_) {
+            standing_query_handler_(match);
+        } else {
+            standing_query_matches_.push_back(match);
+        }
+    }
+}
+
+SearchServer::QueryTermIds SearchServer::ResolveStandingQuery(const StandingQuery& query) const {
+    Query parsed;
+    parsed.plus_words.assign(query.plus_words.begin(), query.plus_words.end());
+    parsed.minus_words.assign(query.minus_words.begin(), query.minus_words.end());
+    for (const auto& phrase : query.phrases) {
+        parsed.phrases.emplace_back(phrase.begin(), phrase.end());
+    }
+    return ResolveQueryTerms(parsed);
+}
+
+WriteAheadLogRecovery SearchServer::OpenWriteAheadLog(const string& directory, const WriteAheadLogOptions& options) {
+    if (write_ahead_log_ || !documents_.empty()) {
+        throw logic_error("Write-ahead log can be opened only once, on an empty server"s);
+    }
+    // пока журнал не открыт, восстановленные документы в него не пишутся
+    auto write_ahead_log = make_unique<WriteAheadLog>(directory, options, [this](vector<LogRecord>& records) {
+        ApplyLogRecords(records);
+    });
+    write_ahead_log_ = move(write_ahead_log);
+    return write_ahead_log_->GetRecovery();
+}
+
+void SearchServer::SyncWriteAheadLog() {
+    if (write_ahead_log_) {
+        write_ahead_log_->Sync();
+    }
+}
+
+void SearchServer::Checkpoint() {
+    if (!write_ahead_log_) {
+        throw logic_error("Write-ahead log is not opened"s);
+    }
+    write_ahead_log_->Checkpoint([this](CheckpointWriter& writer) {
+        for (const auto& [document_id, document] : documents_) {
+            writer.AddDocument(document_id, document.status, document.rating, document.str);
+        }
+    });
+}
+
+void SearchServer::ApplyLogRecords(vector<LogRecord>& records) {
+    for (size_t begin = 0; begin < records.size();) {
+        const LogRecordType type = records[begin].type;
+        size_t end = begin + 1;
+        while (end < records.size() && records[end].type == type) {
+            ++end;
+        }
+        if (type == LogRecordType::ADD) {
+            vector<PreparedDocument> prepared(end - begin);
+            // исключение из параллельного алгоритма завершило бы программу
+            vector<exception_ptr> errors(end - begin);
+            vector<size_t> indices(end - begin);
+            iota(indices.begin(), indices.end(), size_t{0});
+            for_each(execution::par, indices.begin(), indices.end(), [&](size_t i) {
+                const LogRecord& record = records[begin + i];
+                try {
+                    prepared[i] = PrepareDocument(record.document_id, record.text, record.status, {record.rating});
+                } catch (...) {
+                    errors[i] = current_exception();
+                }
+            });
+            for (size_t i = 0; i < prepared.size(); ++i) {
+                if (errors[i]) {
+                    rethrow_exception(errors[i]);
+                }
+                AddDocument(move(prepared[i]));
+            }
+        } else if (type == LogRecordType::REMOVE) {
+            vector<int> document_ids;
+            for (size_t i = begin; i < end; ++i) {
+                document_ids.push_back(records[i].document_id);
+            }
+            RemoveDocuments(document_ids);
+        }
+        begin = end;
+    }
 }
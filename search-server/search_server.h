@@ -3,48 +3,154 @@
 #include <string>
 #include <map>
 #include <set>
+#include <deque>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <iterator>
 #include <execution>
+#include <future>
+#include <numeric>
+#include <queue>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include "document.h"
 #include "read_input_functions.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "bloom_filter.h"
+#include "positional_index.h"
+#include "roaring_bitmap.h"
+#include "query_control.h"
+#include "query_executor.h"
+#include "query_planner.h"
+#include "sorted_intersection.h"
+#include "standing_query_index.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "top_document_list.h"
+#include "write_ahead_log.h"
 #include <mutex>
 
 using namespace std;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const float EPS = 1e-6;
+const int POSTING_BLOCK_SIZE = 1024;
+// Удалённые документы вычищаются из списков пакетом, когда их накопится
+// не меньше PURGE_MIN_REMOVED_DOCUMENTS и не меньше 1/PURGE_LIVE_DOCUMENTS_RATIO живых
+const size_t PURGE_MIN_REMOVED_DOCUMENTS = 1024;
+const size_t PURGE_LIVE_DOCUMENTS_RATIO = 8;
+// Релевантность документа умножается на 1 + PROXIMITY_WEIGHT / d, где d - наименьшее
+// расстояние между разными словами запроса в документе (нужен позиционный индекс)
+const double PROXIMITY_WEIGHT = 0.5;
+// Слово запроса вида cat* заменяется не более чем на столько первых по алфавиту слов индекса
+const size_t MAX_PREFIX_EXPANSION = 128;
+// Наименьшая ёмкость фильтра Блума по словам индекса
+const size_t MIN_TERM_FILTER_CAPACITY = 1024;
+// Список документов такой длины и больше хранит id в битовой карте
+const size_t BITMAP_POSTINGS_MIN_DOCUMENTS = 4096;
+// Материализованный список горячего слова хранит столько лучших документов каждого статуса
+const size_t HOT_TERM_TOP_DOCUMENTS = 64;
+// Слово становится горячим не раньше, чем после стольких однословных запросов, и только если
+// его список документов длиннее материализованного хотя бы в HOT_TERM_MIN_DOCUMENTS_RATIO раз
+const uint32_t HOT_TERM_MIN_QUERIES = 16;
+const size_t HOT_TERM_MIN_DOCUMENTS_RATIO = 4;
+// Через каждые столько однословных запросов счётчики запросов слов уменьшаются вдвое
+const uint64_t HOT_TERM_DECAY_INTERVAL = 1 << 16;
+// Веса оценки работы для планировщика (query_planner.h): учёт близости слов обходит их
+// позиции, а сопоставление документа с запросом ищет каждое слово среди слов документа
+const size_t POSITIONAL_WORK_FACTOR = 4;
+const size_t MATCH_WORK_PER_TERM = 8;
 
 struct QueryWord {
     string_view data;
     bool is_minus;
     bool is_stop;
+    bool is_prefix;
 };
 
 struct Query {
     vector<string_view> plus_words;
     vector<string_view> minus_words;
+    // фразы в кавычках, их слова входят и в plus_words
+    vector<vector<string_view>> phrases;
+};
+
+// Фильтры, для которых FindTopDocuments выбирает специализированное ядро ранжирования.
+// Любой другой предикат вызывается как bool(int document_id, DocumentStatus status, int rating).
+struct AnyDocument {
+};
+
+struct DocumentIdSet {
+    explicit DocumentIdSet(vector<int> document_ids)
+        : ids(move(document_ids)) {
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    vector<int> ids;
+};
+
+struct SearchServerOptions {
+    // число потоков для асинхронных запросов, 0 - по числу ядер
+    size_t executor_threads = 0;
+    // хранить позиции слов: фразы в кавычках и учёт близости слов запроса
+    bool positional_index = false;
+    // дополнительно хранить списки документов, упорядоченные по вкладу в релевантность:
+    // запросы из одного-двух слов тогда останавливаются, как только лучшие документы найдены
+    // (добавление документа дописывает в конец списка, упорядочивание откладывается до запроса)
+    bool impact_ordered_postings = false;
+    // списки документов не короче этого хранят id в сжатой битовой карте, 0 - не хранить;
+    // фильтр по статусу для них - пересечение с битовой картой документов этого статуса
+    size_t bitmap_postings_min_documents = BITMAP_POSTINGS_MIN_DOCUMENTS;
+    // для скольких самых частых слов однословных запросов хранить готовые лучшие документы
+    // (по hot_term_top_documents каждого статуса), 0 - не хранить
+    size_t hot_terms = 0;
+    size_t hot_term_top_documents = HOT_TERM_TOP_DOCUMENTS;
+    // с какой оценки работы вызовы без политики выполнения идут параллельно: 0 - порог из
+    // калибровки при старте процесса, 1 - всегда, NEVER_PARALLEL - никогда
+    size_t parallel_min_work = 0;
+};
+
+// Документ, разобранный на слова заранее: SearchServer::PrepareDocument не меняет
+// сервер и может вызываться из нескольких потоков, пока другой поток добавляет документы
+struct PreparedDocument {
+    int id;
+    DocumentStatus status;
+    int rating;
+    string text;
+    // смещение и длина каждого слова (кроме стоп-слов) в text
+    vector<pair<uint32_t, uint32_t>> words;
 };
 
 class SearchServer {
 public:
 
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
-    explicit SearchServer( string_view stop_words_text);
-    explicit SearchServer(const string& stop_words_text);
+    explicit SearchServer(const StringContainer& stop_words, const SearchServerOptions& options = {});
+    // стоп-слова, хеш-таблица которых построена на этапе компиляции
+    template <size_t N>
+    explicit SearchServer(const StaticStopWordSet<N>& stop_words, const SearchServerOptions& options = {});
+    explicit SearchServer( string_view stop_words_text, const SearchServerOptions& options = {});
+    explicit SearchServer(const string& stop_words_text, const SearchServerOptions& options = {});
 
     void AddDocument(int document_id,  string_view document, DocumentStatus status, const vector<int>& ratings);
+    PreparedDocument PrepareDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) const;
+    void AddDocument(PreparedDocument document);
 
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& police, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
+    // Без политики выполнения seq или par выбирает планировщик, см. PlanQuery
     template <typename DocumentPredicate>
     vector<Document> FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const;
 
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchResult FindTopDocuments(ExecutionPolicy&& police, string_view raw_query, DocumentPredicate document_predicate, const QueryControl& control) const;
+
     vector<Document> FindTopDocuments(const std::execution::sequenced_policy&,string_view raw_query, DocumentStatus status) const ;
     vector<Document> FindTopDocuments(const std::execution::parallel_policy&,string_view raw_query, DocumentStatus status) const ;
     vector<Document> FindTopDocuments( string_view raw_query, DocumentStatus status) const ;
@@ -53,18 +159,80 @@ public:
     vector<Document> FindTopDocuments(const std::execution::sequenced_policy&,string_view raw_query) const;
     vector<Document> FindTopDocuments(const std::execution::parallel_policy&,string_view raw_query) const;
 
+    // Работа запроса оценивается по длинам списков документов его слов, виду фильтра и числу
+    // документов (для общего предиката) и сравнивается с порогом parallel_min_work
+    template <typename DocumentPredicate>
+    ExecutionPlan PlanQuery(string_view raw_query, DocumentPredicate document_predicate) const;
+    // BATCHED, если суммарная работа пакета запросов по статусу ACTUAL окупает параллельность
+    ExecutionPlan PlanQueries(const vector<string>& queries) const;
+    const QueryCostModel& GetCostModel() const {
+        return cost_model_;
+    }
+
+    // Асинхронные версии выполняются на пуле потоков сервера
+    template <typename DocumentPredicate>
+    future<SearchResult> FindTopDocumentsAsync(string_view raw_query, DocumentPredicate document_predicate, QueryControl control = {}) const;
+    future<SearchResult> FindTopDocumentsAsync(string_view raw_query, DocumentStatus status, QueryControl control = {}) const;
+    future<SearchResult> FindTopDocumentsAsync(string_view raw_query, QueryControl control = {}) const;
+
+    // Постраничный поиск: page_size документов, следующих в выдаче за курсором after, в порядке
+    // FindTopDocuments (релевантность с точностью EPS, затем рейтинг, затем id). Кроме запросов,
+    // которые отвечаются из горячих слов или списков по вкладу, каждая страница заново оценивает
+    // все списки документов слов запроса, то есть стоит как полный поиск; документы до курсора
+    // отбрасываются по релевантности до поиска рейтинга и не сортируются.
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchPage FindNextDocuments(ExecutionPolicy&& police, string_view raw_query, DocumentPredicate document_predicate,
+                                 const SearchCursor& after, size_t page_size) const;
+    SearchPage FindNextDocuments(string_view raw_query, DocumentStatus status, const SearchCursor& after, size_t page_size) const;
+    SearchPage FindNextDocuments(string_view raw_query, const SearchCursor& after, size_t page_size) const;
+
     int GetDocumentCount() const;
     void RemoveDocument(const execution::parallel_policy&, int document_id);
     void RemoveDocument(const execution::sequenced_policy&, int document_id);
     tuple<vector<string_view>, DocumentStatus> MatchDocument(string_view raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    // Матчинг одного запроса с набором документов: запрос разбирается один раз
+    vector<tuple<vector<string_view>, DocumentStatus>> MatchDocuments(string_view raw_query, const vector<int>& document_ids) const;
+    vector<tuple<vector<string_view>, DocumentStatus>> MatchDocuments(const std::execution::sequenced_policy&, string_view raw_query, const vector<int>& document_ids) const;
+    vector<tuple<vector<string_view>, DocumentStatus>> MatchDocuments(const std::execution::parallel_policy&, string_view raw_query, const vector<int>& document_ids) const;
     const map<string_view, double>& GetWordFrequencies(int document_id) const;
     Query ParseQuery(const std::string_view text, bool no_sort) const;
     set<int>::const_iterator begin() const;
     set<int>::const_iterator end() const;
     void RemoveDocument(int document_id);
+    void RemoveDocuments(const vector<int>& document_ids);
+    // Сразу вычищает из списков документов все помеченные удалёнными документы
+    void PurgeRemovedDocuments();
     map<int,set<string>> GetDocsDuplicate();
+    // Объём памяти позиционного индекса в байтах
+    size_t GetPositionalIndexMemoryUsage() const;
+    // Объём памяти списков документов слов в байтах
+    size_t GetPostingsMemoryUsage() const;
+
+    // Постоянные запросы: каждый добавляемый документ сверяется только с запросами, слова
+    // которых в нём есть, и совпадения передаются обработчику или копятся в очереди.
+    // Запрос - плюс- и минус-слова и фразы, как в FindTopDocuments, с фильтром по статусу;
+    // слова с * не поддерживаются. Запрос с фразой при позиционном индексе становится
+    // кандидатом только по самому редкому слову фраз.
+    int AddStandingQuery(string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    void RemoveStandingQuery(int query_id);
+    size_t GetStandingQueryCount() const;
+    // Обработчик вызывается внутри AddDocument, после того как документ добавлен; без
+    // обработчика совпадения забираются TakeStandingQueryMatches
+    void SetStandingQueryHandler(StandingQueryHandler handler);
+    vector<StandingQueryMatch> TakeStandingQueryMatches();
+
+    // Журнал изменений в каталоге directory (write_ahead_log.h). Сервер должен быть пустым:
+    // документы восстанавливаются из снимка и журнала, после чего каждое успешное добавление
+    // и удаление дописывается в журнал. Стоп-слова, настройки и постоянные запросы в журнал
+    // не входят. Ошибка записи журнала бросается из следующего изменения или SyncWriteAheadLog;
+    // изменение, из которого она брошена, не выполняется.
+    WriteAheadLogRecovery OpenWriteAheadLog(const string& directory, const WriteAheadLogOptions& options = {});
+    // Ждёт, пока все сделанные изменения окажутся на диске; без журнала ничего не делает
+    void SyncWriteAheadLog();
+    // Снимок всех документов заменяет прежний, журнал очищается
+    void Checkpoint();
 
 private:
 
@@ -74,12 +242,118 @@ private:
         string str;
     };
 
-    const set<string,less<>> stop_words_;
+    // Список документов слова, упорядоченный по id, в виде параллельных массивов.
+    // Статус продублирован здесь, чтобы фильтр по статусу не обращался к documents_.
+    // Удалённые документы остаются в массивах до очистки, document_count их не учитывает.
+    // Id длинного списка хранятся в bitmap, а document_ids пуст; term_freqs и statuses
+    // тогда идут в порядке возрастания id, номер документа в них - bitmap.Rank(id).
+    struct PostingList {
+        vector<int> document_ids;
+        RoaringBitmap bitmap;
+        bool is_bitmap = false;
+        vector<double> term_freqs;
+        vector<DocumentStatus> statuses;
+        int document_count = 0;
+
+        size_t GetSize() const {
+            return term_freqs.size();
+        }
+        bool Contains(int document_id) const;
+        double GetTermFreq(int document_id) const;
+        // bitmap_min_documents - с какой длины список переводится в битовую карту, 0 - никогда
+        void Insert(int document_id, double term_freq, DocumentStatus status, size_t bitmap_min_documents);
+        void Purge(const vector<bool>& removed_documents, size_t bitmap_min_documents);
+    };
+
+    // Элемент списка документов, упорядоченного по убыванию TF, затем рейтинга
+    struct ImpactEntry {
+        int document_id;
+        double term_freq;
+        int rating;
+        DocumentStatus status;
+    };
+
+    // Лучшие документы горячего слова по статусам
+    using HotTermLists = array<TopDocumentList, 4>;
+
+    // Всё, что нужно для сверки запроса с документом без обращения к самому запросу:
+    // при сотне тысяч запросов каждое лишнее обращение - промах кеша
+    struct StandingQueryScore {
+        double relevance = 0.0;
+        bool is_candidate = false;
+        // без минус-слов и фраз совпадение не нужно проверять по документу
+        bool has_only_plus_words = false;
+    };
+
+    // Накопитель релевантности: id по возрастанию и соответствующие им значения
+    struct ScoredDocuments {
+        vector<int> ids;
+        vector<double> relevances;
+    };
+
+    const SearchServerOptions options_;
+    const QueryCostModel cost_model_;
+    // стоп-слова в минимальной совершенной хеш-таблице
+    const StopWordSet stop_words_;
+    // Идентификаторы слов запроса, отсортированные по возрастанию
+    struct QueryTermIds {
+        vector<int> plus_ids;
+        vector<int> minus_ids;
+        // слова фраз в порядке следования, -1 - слова нет в индексе
+        vector<vector<int>> phrase_ids;
+    };
+
     map<int,set<string>> docs_duplecats;
-    map<string_view, map<int, double>> word_to_document_freqs_;
+    // Словарь: terms_[term_id] хранит слово, на которое ссылаются string_view индексов
+    deque<string> terms_;
+    map<string_view, int> term_to_id_;
+    // фильтр Блума по словам term_to_id_: отсекает слова запроса, которых нет в индексе
+    BloomFilter term_filter_;
+    // Прямой индекс: отсортированные идентификаторы слов документа
+    map<int, vector<int>> document_terms_;
+    // позиции слов документа в порядке document_terms_, только при options_.positional_index
+    map<int, DocumentPositions> document_positions_;
+    // postings_[term_id] - документы, содержащие слово terms_[term_id]
+    vector<PostingList> postings_;
+    // impact_postings_[term_id] - те же документы в порядке убывания вклада, только при options_.impact_ordered_postings.
+    // Добавление документа дописывает записи в конец за O(1) на слово; первые
+    // impact_sorted_sizes_[term_id] записей упорядочены, а хвост сортируется и сливается с ними
+    // за O(n + k log k) при первом запросе по слову (под impact_postings_mutex_) или при очистке.
+    mutable vector<vector<ImpactEntry>> impact_postings_;
+    mutable vector<size_t> impact_sorted_sizes_;
+    mutable mutex impact_postings_mutex_;
     map<int,  map<string_view,double>> document_to_word_freqs_;
     map<int, DocumentData> documents_;
     set<int> document_ids_;
+    // живые документы каждого статуса
+    array<RoaringBitmap, 4> status_documents_;
+    // Отложенное удаление: removed_documents_[id] - документ удалён, но ещё есть в postings_
+    vector<bool> removed_documents_;
+    vector<int> pending_removed_ids_;
+    vector<int> dirty_term_ids_;
+    vector<int> free_term_ids_;
+    // снимок словаря для поиска по префиксу, перестраивается после изменения набора слов
+    mutable mutex term_dictionary_mutex_;
+    mutable shared_ptr<const TermDictionary> term_dictionary_;
+    // увеличивается при каждом добавлении и удалении документа
+    uint64_t generation_ = 0;
+    // Горячие слова: набор выбирают запросы под hot_terms_mutex_, а добавление и удаление
+    // документов обновляют списки на месте. term_query_counts_[term_id] - число однословных
+    // запросов слова, используется только при options_.hot_terms.
+    mutable mutex hot_terms_mutex_;
+    mutable unordered_map<int, shared_ptr<HotTermLists>> hot_terms_;
+    mutable deque<atomic<uint32_t>> term_query_counts_;
+    mutable atomic<uint64_t> single_term_query_count_ = 0;
+    // Постоянные запросы. term_standing_triggers_[term_id] - запросы, для которых слово
+    // триггер, nullptr - таких нет; standing_query_scores_[query_id] накапливает
+    // релевантность кандидата для одного документа.
+    StandingQueryIndex standing_queries_;
+    vector<const StandingQueryTriggers*> term_standing_triggers_;
+    StandingQueryHandler standing_query_handler_;
+    vector<StandingQueryMatch> standing_query_matches_;
+    vector<StandingQueryScore> standing_query_scores_;
+    vector<int> standing_query_candidates_;
+    unique_ptr<WriteAheadLog> write_ahead_log_;
 
     bool IsStopWord(const string_view word) const;
     static bool IsValidWord(const string_view word);
@@ -87,19 +361,117 @@ private:
     static int ComputeAverageRating(const vector<int>& ratings);
     QueryWord ParseQueryWord(string_view text) const;
     Query ParseQuery(string_view text) const ;
-    double ComputeWordInverseDocumentFreq( string_view word) const;
-
+    double ComputeTermInverseDocumentFreq(int term_id) const;
+    int GetOrAddTermId(string_view word);
+    int FindTermId(string_view word) const;
+    void RebuildTermFilter();
+    bool MarkDocumentRemoved(int document_id);
+    void PurgeIfNeeded();
+    bool IsDocumentRemoved(int document_id) const {
+        return static_cast<size_t>(document_id) < removed_documents_.size() && removed_documents_[document_id];
+    }
+    void DropRemovedDocuments(ScoredDocuments& scored) const;
+    static bool HasHigherImpact(const ImpactEntry& lhs, const ImpactEntry& rhs);
+    // упорядочивает дописанный хвост списка; вызывается под impact_postings_mutex_ или при изменении сервера
+    void SortImpactPostings(int term_id) const;
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
+    static bool IsAfterCursor(const Document& document, const SearchCursor& after);
+    static void KeepDocumentsAfter(const SearchCursor& after, vector<Document>& documents);
+    // Отбрасывает документы, которые релевантнее курсора больше чем на EPS: они стоят до него
+    // при любом рейтинге, а множитель позиций не уменьшает ненулевую релевантность.
+    // Остальные проверяет KeepDocumentsAfter.
+    static void DropDocumentsBeforeCursor(const SearchCursor& after, ScoredDocuments& scored);
+    double GetTermFreq(int term_id, int document_id) const;
+    bool ContainsAnyTerm(const vector<int>& term_ids, int document_id) const;
+    bool CanUseImpactOrder(const QueryTermIds& query_terms) const;
+    // Учитывает запрос слова и возвращает его списки, если слово горячее (возможно, только что)
+    shared_ptr<const HotTermLists> GetHotTermLists(int term_id) const;
+    HotTermLists BuildHotTermLists(int term_id) const;
+    // горячее слово, запрашиваемое реже остальных; вызывается под hot_terms_mutex_
+    int FindColdestHotTerm() const;
+    vector<int> RemoveFromHotTerms(int document_id, DocumentStatus status, const vector<int>& term_ids);
+    void MatchStandingQueries(int document_id, DocumentStatus status, const vector<int>& term_ids, const vector<double>& term_freqs,
+                              const map<string_view, double>& document_words);
+    QueryTermIds ResolveStandingQuery(const StandingQuery& query) const;
+    // Подряд идущие добавления разбираются на слова параллельно и добавляются по порядку журнала
+    void ApplyLogRecords(vector<LogRecord>& records);
+    template <typename DocumentPredicate>
+    bool FindHotTermDocuments(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate,
+                              const SearchCursor& after, size_t result_count, vector<Document>& documents) const;
+    template <typename DocumentPredicate>
+    static bool MatchesFilter(const DocumentPredicate& document_predicate, int document_id, DocumentStatus status, int rating);
+    template <typename DocumentPredicate>
+    vector<Document> FindTopDocumentsByImpact(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate,
+                                              const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                              bool& truncated) const;
+    bool UsesPositions(const QueryTermIds& query_terms) const;
+    double ComputePositionalFactor(const QueryTermIds& query_terms, int document_id) const;
+    void ApplyPositionalFactors(const std::execution::sequenced_policy&, const QueryTermIds& query_terms, ScoredDocuments& scored) const;
+    void ApplyPositionalFactors(const std::execution::parallel_policy&, const QueryTermIds& query_terms, ScoredDocuments& scored) const;
+    QueryTermIds ResolveQueryTerms(const Query& query) const;
+    tuple<vector<string_view>, DocumentStatus> MatchDocumentTerms(const QueryTermIds& query_terms, int document_id) const;
+    template <typename ExecutionPolicy>
+    vector<tuple<vector<string_view>, DocumentStatus>> MatchDocumentTerms(ExecutionPolicy&& police, const QueryTermIds& query_terms,
+                                                                           const vector<int>& document_ids) const;
+    template <typename DocumentPredicate>
+    size_t EstimateQueryWork(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate) const;
+    template <typename DocumentPredicate>
+    ExecutionPlan PlanQuery(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchResult FindTopDocumentsForQuery(ExecutionPolicy&& police, const QueryTermIds& query_terms,
+                                          const DocumentPredicate& document_predicate, const QueryControl& control) const;
+    QueryExecutor& GetExecutor() const;
+    static void MergeScores(ScoredDocuments& accumulated, ScoredDocuments& addition);
+    static void ExcludeDocuments(ScoredDocuments& scored, const vector<int>& excluded_ids);
+    static void IntersectDocuments(ScoredDocuments& scored, const vector<int>& document_ids);
+    template <typename Predicate>
+    static void KeepDocuments(ScoredDocuments& scored, Predicate predicate);
+    static ScoredDocuments MergeAllScores(vector<ScoredDocuments>& term_scores);
+    void ExcludeTermDocuments(const vector<int>& term_ids, ScoredDocuments& scored) const;
+    void KeepPhraseDocuments(const QueryTermIds& query_terms, ScoredDocuments& scored) const;
+    shared_ptr<const TermDictionary> GetTermDictionary() const;
+    vector<string_view> ExpandPrefix(string_view prefix) const;
 
     template <typename DocumentPredicate>
-    vector<Document> FindAllDocuments(const std::execution::sequenced_policy&,const Query& query, DocumentPredicate document_predicate) const;
+    bool ScorePostings(const PostingList& postings, double inverse_document_freq, const DocumentPredicate& document_predicate,
+                       const QueryControl& control, ScoredDocuments& scored) const;
+    bool ScoreBitmapPostings(const PostingList& postings, double inverse_document_freq, DocumentStatus status,
+                             const QueryControl& control, ScoredDocuments& scored) const;
+    template <typename ExecutionPolicy>
+    vector<Document> MakeDocuments(ExecutionPolicy&& police, const ScoredDocuments& scored) const;
+
+    // Документы, следующие в выдаче за курсором after. result_count - сколько из них нужно
+    // вызывающему: по нему ранний останов решает, что лучшие документы уже найдены.
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,DocumentPredicate document_predicate) const;
+    vector<Document> FindAllDocuments(const std::execution::sequenced_policy&,const QueryTermIds& query_terms, DocumentPredicate document_predicate,
+                                      const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                      bool& truncated) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const QueryTermIds& query_terms,DocumentPredicate document_predicate,
+                                           const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                           bool& truncated) const;
 
+    // пул создаётся при первом асинхронном запросе и останавливается первым при разрушении сервера
+    mutable once_flag executor_once_;
+    mutable unique_ptr<QueryExecutor> executor_;
 };
 
 template <typename StringContainer>
-SearchServer:: SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+SearchServer:: SearchServer(const StringContainer& stop_words, const SearchServerOptions& options)
+    : options_(options)
+    , cost_model_(MakeQueryCostModel(options.parallel_min_work))
+    , stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+{
+    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+        throw invalid_argument("Some of stop words are invalid"s);
+    }
+}
+
+template <size_t N>
+SearchServer:: SearchServer(const StaticStopWordSet<N>& stop_words, const SearchServerOptions& options)
+    : options_(options)
+    , cost_model_(MakeQueryCostModel(options.parallel_min_work))
+    , stop_words_(stop_words)
 {
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw invalid_argument("Some of stop words are invalid"s);
@@ -110,109 +482,452 @@ SearchServer:: SearchServer(const StringContainer& stop_words)
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer:: FindTopDocuments(ExecutionPolicy&& police, std::string_view raw_query,
                                                       DocumentPredicate document_predicate) const {
+    return FindTopDocuments(police, raw_query, document_predicate, QueryControl{}).documents;
+}
 
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(police, query, document_predicate);
-    std::sort(police,matched_documents.begin(), matched_documents.end(),
-              [](const Document& lhs, const Document& rhs) {
-        return lhs.relevance > rhs.relevance
-                || (std::abs(lhs.relevance - rhs.relevance) < EPS && lhs.rating > rhs.rating);
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchResult SearchServer:: FindTopDocuments(ExecutionPolicy&& police, std::string_view raw_query,
+                                             DocumentPredicate document_predicate, const QueryControl& control) const {
+    return FindTopDocumentsForQuery(police, ResolveQueryTerms(ParseQuery(raw_query)), document_predicate, control);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchResult SearchServer:: FindTopDocumentsForQuery(ExecutionPolicy&& police, const QueryTermIds& query_terms,
+                                                     const DocumentPredicate& document_predicate, const QueryControl& control) const {
+    bool truncated = false;
+    auto matched_documents = FindAllDocuments(police, query_terms, document_predicate, control, SearchCursor{}, MAX_RESULT_DOCUMENT_COUNT,
+                                              truncated);
+    // нужны только первые MAX_RESULT_DOCUMENT_COUNT документов, остальные не упорядочиваем;
+    // порядок тот же, что у постраничного поиска, поэтому первая страница совпадает с этой выдачей
+    const size_t result_count = std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(police, matched_documents.begin(), matched_documents.begin() + result_count, matched_documents.end(),
+                      IsRankedBefore);
+    matched_documents.resize(result_count);
+    return {matched_documents, truncated};
 
 }
 
 template <typename DocumentPredicate>
 vector<Document> SearchServer:: FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::par,raw_query,document_predicate);
+    const QueryTermIds query_terms = ResolveQueryTerms(ParseQuery(raw_query));
+    if (PlanQuery(query_terms, document_predicate) == ExecutionPlan::PARALLEL) {
+        return FindTopDocumentsForQuery(std::execution::par, query_terms, document_predicate, QueryControl{}).documents;
+    }
+    return FindTopDocumentsForQuery(std::execution::seq, query_terms, document_predicate, QueryControl{}).documents;
 }
 
 template <typename DocumentPredicate>
-vector<Document> SearchServer:: FindAllDocuments(const std::execution::sequenced_policy&,const Query& query, DocumentPredicate document_predicate) const {
-    map<int, double> document_to_relevance;
-    for (auto word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+ExecutionPlan SearchServer:: PlanQuery(string_view raw_query, DocumentPredicate document_predicate) const {
+    return PlanQuery(ResolveQueryTerms(ParseQuery(raw_query)), document_predicate);
+}
+
+template <typename DocumentPredicate>
+ExecutionPlan SearchServer:: PlanQuery(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate) const {
+    return EstimateQueryWork(query_terms, document_predicate) >= cost_model_.parallel_min_work ? ExecutionPlan::PARALLEL
+                                                                                              : ExecutionPlan::SEQUENTIAL;
+}
+
+// Ядра ранжирования обходят списки документов целиком, поэтому работа - их суммарная длина.
+// Набор id проверяется слиянием и стоит не больше своего размера на слово, общий предикат
+// дополнительно ищет каждый документ в documents_ за log2(N) сравнений.
+template <typename DocumentPredicate>
+size_t SearchServer:: EstimateQueryWork(const QueryTermIds& query_terms, [[maybe_unused]] const DocumentPredicate& document_predicate) const {
+    // ранний останов по спискам в порядке вклада просматривает только их начало
+    if (CanUseImpactOrder(query_terms)) {
+        return 0;
+    }
+    size_t work = 0;
+    for (const int term_id : query_terms.plus_ids) {
+        size_t term_work = postings_[term_id].GetSize();
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentIdSet>) {
+            term_work = std::min(term_work, document_predicate.ids.size());
+        } else if constexpr (!std::is_same_v<DocumentPredicate, AnyDocument> && !std::is_same_v<DocumentPredicate, DocumentStatus>) {
+            term_work *= 1 + static_cast<size_t>(std::log2(documents_.size() + 1));
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
+        work += term_work;
+    }
+    for (const int term_id : query_terms.minus_ids) {
+        work += postings_[term_id].GetSize();
+    }
+    if (UsesPositions(query_terms)) {
+        work *= POSITIONAL_WORK_FACTOR;
+    }
+    return work;
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchPage SearchServer:: FindNextDocuments(ExecutionPolicy&& police, string_view raw_query, DocumentPredicate document_predicate,
+                                            const SearchCursor& after, size_t page_size) const {
+    if (page_size == 0) {
+        throw invalid_argument("Page size must be positive"s);
+    }
+    SearchPage page;
+    page.index_changed = !after.is_start_ && after.generation_ != generation_;
+    if (after.is_end_) {
+        page.next = after;
+        return page;
+    }
+
+    bool truncated = false;
+    auto documents = FindAllDocuments(police, ResolveQueryTerms(ParseQuery(raw_query)), document_predicate, QueryControl{}, after,
+                                      page_size, truncated);
+    const size_t result_count = std::min(documents.size(), page_size);
+    std::partial_sort(police, documents.begin(), documents.begin() + result_count, documents.end(), IsRankedBefore);
+    documents.resize(result_count);
+
+    if (result_count < page_size) {
+        page.next.is_end_ = true;
+    } else {
+        const Document& last = documents.back();
+        page.next.is_start_ = false;
+        page.next.relevance_ = last.relevance;
+        page.next.rating_ = last.rating;
+        page.next.document_id_ = last.id;
+        page.next.generation_ = generation_;
+    }
+    page.documents = move(documents);
+    return page;
+}
+
+template <typename DocumentPredicate>
+future<SearchResult> SearchServer:: FindTopDocumentsAsync(string_view raw_query, DocumentPredicate document_predicate, QueryControl control) const {
+    return GetExecutor().Submit([this, query = string(raw_query), document_predicate, control] {
+        return FindTopDocuments(std::execution::seq, query, document_predicate, control);
+    });
+}
+
+// Ядро ранжирования одного списка документов. Тип фильтра известен на этапе компиляции,
+// поэтому во внутренний цикл попадают только нужные ему данные: без фильтра - ни одной
+// загрузки метаданных, по статусу - только столбец статусов, по набору id - слияние
+// отсортированных массивов. Общий предикат получает данные документа из documents_.
+// Возвращает false, если запрос был прерван между блоками.
+template <typename DocumentPredicate>
+bool SearchServer:: ScorePostings(const PostingList& postings, double inverse_document_freq, const DocumentPredicate& document_predicate,
+                                  const QueryControl& control, ScoredDocuments& scored) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+        // пересечение окупается для редкого статуса, для частого дешевле распаковать список
+        if (postings.is_bitmap
+            && status_documents_[static_cast<size_t>(document_predicate)].GetCardinality() * 2 < documents_.size()) {
+            return ScoreBitmapPostings(postings, inverse_document_freq, document_predicate, control, scored);
         }
     }
+    const size_t posting_count = postings.GetSize();
+    scored.ids.resize(posting_count);
+    scored.relevances.resize(posting_count);
+    // id из битовой карты распаковываются на место результата: ядра ниже пишут
+    // i-й документ не дальше i-й позиции и не затирают ещё не прочитанные id
+    if (postings.is_bitmap) {
+        postings.bitmap.Decode(scored.ids.data());
+    }
+    const int* ids = postings.is_bitmap ? scored.ids.data() : postings.document_ids.data();
+    const double* term_freqs = postings.term_freqs.data();
+    int* out_ids = scored.ids.data();
+    double* out_relevances = scored.relevances.data();
+
+    size_t matched = 0;
+    bool completed = true;
+    [[maybe_unused]] size_t set_pos = 0;
+    for (size_t block_begin = 0; block_begin < posting_count; block_begin += POSTING_BLOCK_SIZE) {
+        if (control.IsExpired()) {
+            completed = false;
+            break;
+        }
+        const size_t block_end = std::min(posting_count, block_begin + POSTING_BLOCK_SIZE);
 
-    for (auto word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+        if constexpr (std::is_same_v<DocumentPredicate, AnyDocument>) {
+            for (size_t i = block_begin; i < block_end; ++i) {
+                out_ids[i] = ids[i];
+                out_relevances[i] = term_freqs[i] * inverse_document_freq;
+            }
+            matched = block_end;
+        } else if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+            const DocumentStatus* statuses = postings.statuses.data();
+            for (size_t i = block_begin; i < block_end; ++i) {
+                out_ids[matched] = ids[i];
+                out_relevances[matched] = term_freqs[i] * inverse_document_freq;
+                matched += statuses[i] == document_predicate;
+            }
+        } else if constexpr (std::is_same_v<DocumentPredicate, DocumentIdSet>) {
+            const vector<int>& allowed = document_predicate.ids;
+            const int* block_first = ids + block_begin;
+            const int* block_last = ids + block_end;
+            for (; set_pos < allowed.size() && allowed[set_pos] <= block_last[-1]; ++set_pos) {
+                block_first = GallopingLowerBound(block_first, block_last, allowed[set_pos]);
+                if (block_first != block_last && *block_first == allowed[set_pos]) {
+                    out_ids[matched] = *block_first;
+                    out_relevances[matched] = term_freqs[block_first - ids] * inverse_document_freq;
+                    ++matched;
+                }
+            }
+        } else {
+            for (size_t i = block_begin; i < block_end; ++i) {
+                if (IsDocumentRemoved(ids[i])) {
+                    continue;
+                }
+                const auto& document_data = documents_.at(ids[i]);
+                if (document_predicate(ids[i], document_data.status, document_data.rating)) {
+                    out_ids[matched] = ids[i];
+                    out_relevances[matched] = term_freqs[i] * inverse_document_freq;
+                    ++matched;
+                }
+            }
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+    }
+    scored.ids.resize(matched);
+    scored.relevances.resize(matched);
+    if constexpr (std::is_same_v<DocumentPredicate, AnyDocument> || std::is_same_v<DocumentPredicate, DocumentStatus>
+                  || std::is_same_v<DocumentPredicate, DocumentIdSet>) {
+        if (!pending_removed_ids_.empty()) {
+            DropRemovedDocuments(scored);
         }
     }
+    return completed;
+}
 
-    vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+template <typename Predicate>
+void SearchServer:: KeepDocuments(ScoredDocuments& scored, Predicate predicate) {
+    size_t kept = 0;
+    for (size_t i = 0; i < scored.ids.size(); ++i) {
+        if (predicate(scored.ids[i])) {
+            scored.ids[kept] = scored.ids[i];
+            scored.relevances[kept] = scored.relevances[i];
+            ++kept;
+        }
     }
-    return matched_documents;
+    scored.ids.resize(kept);
+    scored.relevances.resize(kept);
 }
 
-
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer:: FindAllDocuments(const std::execution::parallel_policy&, const Query& query,DocumentPredicate document_predicate) const {
-
+bool SearchServer:: MatchesFilter(const DocumentPredicate& document_predicate, int document_id, DocumentStatus status, int rating) {
+    if constexpr (std::is_same_v<DocumentPredicate, AnyDocument>) {
+        return true;
+    } else if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+        return status == document_predicate;
+    } else if constexpr (std::is_same_v<DocumentPredicate, DocumentIdSet>) {
+        return binary_search(document_predicate.ids.begin(), document_predicate.ids.end(), document_id);
+    } else {
+        return document_predicate(document_id, status, rating);
+    }
+}
 
-    std::map<int, double> document_to_relevance;
-    ConcurrentMap<int, double> concurrent_map(16);
+// Обход списков в порядке убывания вклада (до двух слов). Документ, ещё не встреченный
+// ни в одном списке, наберёт не больше суммы вкладов текущих позиций списков, поэтому
+// обход прекращается, как только result_count-й найденный за курсором документ
+// гарантированно выше этой границы. Возвращает найденных кандидатов без сортировки.
+template <typename DocumentPredicate>
+vector<Document> SearchServer:: FindTopDocumentsByImpact(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate,
+                                                         const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                                         bool& truncated) const {
+    const size_t term_count = query_terms.plus_ids.size();
+    const vector<ImpactEntry>* lists[2] = {};
+    double inverse_document_freqs[2] = {};
+    size_t cursors[2] = {};
+    {
+        lock_guard guard(impact_postings_mutex_);
+        for (size_t i = 0; i < term_count; ++i) {
+            SortImpactPostings(query_terms.plus_ids[i]);
+        }
+    }
+    for (size_t i = 0; i < term_count; ++i) {
+        lists[i] = &impact_postings_[query_terms.plus_ids[i]];
+        inverse_document_freqs[i] = ComputeTermInverseDocumentFreq(query_terms.plus_ids[i]);
+    }
 
-    for_each(
-                std::execution::par,
-                query.minus_words.begin(),
-                query.minus_words.end(),
-                [this, &document_predicate, &concurrent_map](std::string_view word) {
-        if (!word_to_document_freqs_.count(word) == 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                concurrent_map.Erase(document_id);
+    vector<Document> candidates;
+    std::priority_queue<double, vector<double>, std::greater<double>> top_relevances;
+    std::unordered_set<int> seen;
+    truncated = control.IsExpired();
+    for (size_t visited = 1; !truncated; ++visited) {
+        double threshold = 0.0;
+        size_t best_list = term_count;
+        double best_impact = -1.0;
+        for (size_t i = 0; i < term_count; ++i) {
+            if (cursors[i] < lists[i]->size()) {
+                const double impact = inverse_document_freqs[i] * (*lists[i])[cursors[i]].term_freq;
+                threshold += impact;
+                if (impact > best_impact) {
+                    best_impact = impact;
+                    best_list = i;
+                }
             }
         }
-    }
-    );
+        if (best_list == term_count) {
+            break;
+        }
+        if (top_relevances.size() == result_count && top_relevances.top() > threshold + EPS) {
+            break;
+        }
+        if (visited % POSTING_BLOCK_SIZE == 0 && control.IsExpired()) {
+            truncated = true;
+            break;
+        }
 
-    std::for_each(
-                std::execution::par,
-                query.plus_words.begin(),
-                query.plus_words.end(),
-                [this, &concurrent_map, &document_predicate](std::string_view word) {
-        if (!word_to_document_freqs_.count(word) == 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        const ImpactEntry& entry = (*lists[best_list])[cursors[best_list]++];
+        if (IsDocumentRemoved(entry.document_id)) {
+            continue;
+        }
+        if (term_count == 2 && !seen.insert(entry.document_id).second) {
+            continue;
+        }
+        if (!MatchesFilter(document_predicate, entry.document_id, entry.status, entry.rating)
+                || ContainsAnyTerm(query_terms.minus_ids, entry.document_id)) {
+            continue;
+        }
+        double relevance = best_impact;
+        if (term_count == 2) {
+            const size_t other = 1 - best_list;
+            relevance += inverse_document_freqs[other] * GetTermFreq(query_terms.plus_ids[other], entry.document_id);
+        }
+        const Document document(entry.document_id, relevance, entry.rating);
+        if (!IsAfterCursor(document, after)) {
+            continue;
+        }
+        candidates.push_back(document);
+        top_relevances.push(relevance);
+        if (top_relevances.size() > result_count) {
+            top_relevances.pop();
+        }
+    }
+    return candidates;
+}
 
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    concurrent_map[document_id].ref_to_value += term_freq * inverse_document_freq;
+// Запрос из одного слова без минус-слов, если слово горячее, отвечается из его списков за
+// O(hot_term_top_documents): релевантность считается с текущим IDF, а документы вне списков
+// не выше границы GetBestExcluded. Ответ точен, если result_count-й найденный документ выше
+// границы больше чем на EPS или имеет тот же TF и стоит раньше лучшего не вошедшего в списки:
+// равные TF дают равные релевантности, и тогда порядок решают рейтинг и id (разные TF ближе
+// EPS / IDF считаются различимыми). Иначе false, и запрос идёт обычным путём.
+template <typename DocumentPredicate>
+bool SearchServer:: FindHotTermDocuments(const QueryTermIds& query_terms, const DocumentPredicate& document_predicate,
+                                         const SearchCursor& after, size_t result_count, vector<Document>& documents) const {
+    if constexpr (!std::is_same_v<DocumentPredicate, AnyDocument> && !std::is_same_v<DocumentPredicate, DocumentStatus>) {
+        return false;
+    } else {
+        if (options_.hot_terms == 0 || query_terms.plus_ids.size() != 1 || !query_terms.minus_ids.empty()
+                || !query_terms.phrase_ids.empty() || result_count > options_.hot_term_top_documents) {
+            return false;
+        }
+        const int term_id = query_terms.plus_ids[0];
+        const shared_ptr<const HotTermLists> lists = GetHotTermLists(term_id);
+        if (!lists) {
+            return false;
+        }
+        const double inverse_document_freq = ComputeTermInverseDocumentFreq(term_id);
+        optional<TopDocumentEntry> best_excluded;
+        documents.clear();
+        for (size_t status = 0; status < lists->size(); ++status) {
+            if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+                if (status != static_cast<size_t>(document_predicate)) {
+                    continue;
                 }
             }
+            const TopDocumentList& list = (*lists)[status];
+            for (const TopDocumentEntry& entry : list.GetEntries()) {
+                const Document document(entry.document_id, entry.term_freq * inverse_document_freq, entry.rating);
+                if (IsAfterCursor(document, after)) {
+                    documents.push_back(document);
+                }
+            }
+            const optional<TopDocumentEntry>& excluded = list.GetBestExcluded();
+            if (excluded && (!best_excluded || HasHigherTermFreq(*excluded, *best_excluded))) {
+                best_excluded = excluded;
+            }
+        }
+        if (!best_excluded) {
+            return true;
+        }
+        if (documents.size() < result_count) {
+            return false;
+        }
+        std::nth_element(documents.begin(), documents.begin() + (result_count - 1), documents.end(), IsRankedBefore);
+        const Document& last = documents[result_count - 1];
+        const double bound_relevance = best_excluded->term_freq * inverse_document_freq;
+        return last.relevance > bound_relevance + EPS
+               || (last.relevance == bound_relevance
+                   && IsRankedBefore(last, Document(best_excluded->document_id, bound_relevance, best_excluded->rating)));
+    }
+}
 
+template <typename ExecutionPolicy>
+vector<Document> SearchServer:: MakeDocuments(ExecutionPolicy&& police, const ScoredDocuments& scored) const {
+    vector<Document> matched_documents(scored.ids.size());
+    transform(police, scored.ids.begin(), scored.ids.end(), scored.relevances.begin(), matched_documents.begin(),
+              [this](int document_id, double relevance) {
+        return Document{document_id, relevance, documents_.at(document_id).rating};
+    });
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+vector<Document> SearchServer:: FindAllDocuments(const std::execution::sequenced_policy&,const QueryTermIds& query_terms, DocumentPredicate document_predicate,
+                                                 const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                                 bool& truncated) const {
+    vector<Document> hot_term_documents;
+    if (FindHotTermDocuments(query_terms, document_predicate, after, result_count, hot_term_documents)) {
+        truncated = false;
+        return hot_term_documents;
+    }
+    if (CanUseImpactOrder(query_terms)) {
+        return FindTopDocumentsByImpact(query_terms, document_predicate, control, after, result_count, truncated);
+    }
+    vector<ScoredDocuments> term_scores;
+    term_scores.reserve(query_terms.plus_ids.size());
+    truncated = false;
+    for (const int term_id : query_terms.plus_ids) {
+        truncated = !ScorePostings(postings_[term_id], ComputeTermInverseDocumentFreq(term_id), document_predicate, control,
+                                   term_scores.emplace_back());
+        if (truncated) {
+            break;
         }
     }
-    );
 
-    document_to_relevance = concurrent_map.BuildOrdinaryMap();
+    ScoredDocuments accumulated = MergeAllScores(term_scores);
+    DropDocumentsBeforeCursor(after, accumulated);
+    ExcludeTermDocuments(query_terms.minus_ids, accumulated);
+    if (UsesPositions(query_terms)) {
+        KeepPhraseDocuments(query_terms, accumulated);
+        ApplyPositionalFactors(std::execution::seq, query_terms, accumulated);
+    }
+    auto matched_documents = MakeDocuments(std::execution::seq, accumulated);
+    KeepDocumentsAfter(after, matched_documents);
+    return matched_documents;
+}
 
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
-    mutex freqs_mutex;
 
-    for_each( std::execution::par,  document_to_relevance.begin(), document_to_relevance.end(),
-              [this, &matched_documents,&freqs_mutex](const auto& document) {
-        lock_guard guard(freqs_mutex);
-        matched_documents.push_back({ document.first, document.second,  documents_.at(document.first).rating });
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer:: FindAllDocuments(const std::execution::parallel_policy&, const QueryTermIds& query_terms,DocumentPredicate document_predicate,
+                                                      const QueryControl& control, const SearchCursor& after, size_t result_count,
+                                                      bool& truncated) const {
+    vector<Document> hot_term_documents;
+    if (FindHotTermDocuments(query_terms, document_predicate, after, result_count, hot_term_documents)) {
+        truncated = false;
+        return hot_term_documents;
+    }
+    if (CanUseImpactOrder(query_terms)) {
+        return FindTopDocumentsByImpact(query_terms, document_predicate, control, after, result_count, truncated);
+    }
+    vector<ScoredDocuments> term_scores(query_terms.plus_ids.size());
+    std::atomic_bool interrupted = false;
+
+    std::transform(std::execution::par, query_terms.plus_ids.begin(), query_terms.plus_ids.end(), term_scores.begin(),
+                   [this, &document_predicate, &control, &interrupted](int term_id) {
+        ScoredDocuments scored;
+        if (!interrupted && !ScorePostings(postings_[term_id], ComputeTermInverseDocumentFreq(term_id), document_predicate, control, scored)) {
+            interrupted = true;
+        }
+        return scored;
+    });
+    truncated = interrupted;
+
+    ScoredDocuments accumulated = MergeAllScores(term_scores);
+    DropDocumentsBeforeCursor(after, accumulated);
+    ExcludeTermDocuments(query_terms.minus_ids, accumulated);
+    if (UsesPositions(query_terms)) {
+        KeepPhraseDocuments(query_terms, accumulated);
+        ApplyPositionalFactors(std::execution::par, query_terms, accumulated);
     }
-    );
+    auto matched_documents = MakeDocuments(std::execution::par, accumulated);
+    KeepDocumentsAfter(after, matched_documents);
     return matched_documents;
 }
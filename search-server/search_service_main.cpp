@@ -0,0 +1,114 @@
+#include "benchmark_functions.h"
+#include "command_line.h"
+#include "corpus_import.h"
+#include "log_duration.h"
+#include "network_server.h"
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+const string USAGE =
+    "Usage: search_service [options]\n"
+    "  --tcp PORT             TCP port, 0 - any free port, -1 - no TCP (default 7700)\n"
+    "  --host ADDRESS         IPv4 address to listen on (default 127.0.0.1)\n"
+    "  --unix PATH            also listen on a Unix socket\n"
+    "  --stop-words WORDS     stop words separated by spaces (default \"and in at with\")\n"
+    "  --corpus FILE          corpus for ImportCorpus (default: generated documents)\n"
+    "  --documents N          number of generated documents (default 0)\n"
+    "  --batch N              max requests in one batch (default 256)\n"
+    "  --max-pending N        accepted requests without response before reading stops (default 4096)\n"
+    "  --policy seq|par       execution of searches within a batch (default par)\n"
+    "  --wal DIR              recover documents from the write-ahead log in DIR and log changes;\n"
+    "                         generated or corpus documents are indexed only into an empty log\n"s;
+
+NetworkServer* running_server = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_server != nullptr) {
+        running_server->Stop();
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        map<string, string> arguments = ParseArguments(argc, argv);
+        NetworkServerOptions options;
+        options.tcp_port = stoi(GetArgument(arguments, "tcp"s, "7700"s));
+        options.tcp_host = GetArgument(arguments, "host"s, options.tcp_host);
+        options.unix_socket_path = GetArgument(arguments, "unix"s, ""s);
+        options.max_batch_size = stoul(GetArgument(arguments, "batch"s, to_string(options.max_batch_size)));
+        options.max_pending_requests = stoul(GetArgument(arguments, "max-pending"s, to_string(options.max_pending_requests)));
+        const string policy = GetArgument(arguments, "policy"s, "par"s);
+        if (policy != "seq"s && policy != "par"s) {
+            throw invalid_argument("Unknown policy "s + policy);
+        }
+        options.parallel_batches = policy == "par"s;
+        const string stop_words = GetArgument(arguments, "stop-words"s, "and in at with"s);
+        const string corpus = GetArgument(arguments, "corpus"s, ""s);
+        const int document_count = stoi(GetArgument(arguments, "documents"s, "0"s));
+        const string wal_directory = GetArgument(arguments, "wal"s, ""s);
+        CheckNoArgumentsLeft(arguments);
+
+        SearchServer search_server(stop_words);
+        WriteAheadLogRecovery recovery;
+        if (!wal_directory.empty()) {
+            LOG_DURATION("recovery"sv);
+            recovery = search_server.OpenWriteAheadLog(wal_directory);
+            cerr << recovery.checkpoint_records << " checkpoint records, "s << recovery.log_records << " log records"s;
+            if (recovery.discarded_bytes > 0) {
+                cerr << ", "s << recovery.discarded_bytes << " bytes of torn log discarded"s;
+            }
+            cerr << endl;
+        }
+        if (recovery.checkpoint_records + recovery.log_records == 0) {
+            LOG_DURATION("indexing"sv);
+            if (!corpus.empty()) {
+                ImportCorpus(search_server, corpus);
+            } else if (document_count > 0) {
+                mt19937 generator(42);
+                FillBenchmarkServer(search_server, generator, GenerateDictionary(generator, 20'000, 10), document_count, 20);
+            }
+        }
+
+        // исполнитель сети может ещё выполнять пакет после Stop(): сервер поиска свободен
+        // только после деструктора NetworkServer
+        {
+            NetworkServer network_server(search_server, options);
+            cerr << search_server.GetDocumentCount() << " documents"s;
+            if (network_server.GetTcpPort() != 0) {
+                cerr << ", listening on tcp:"s << options.tcp_host << ':' << network_server.GetTcpPort();
+            }
+            if (!options.unix_socket_path.empty()) {
+                cerr << ", listening on unix:"s << options.unix_socket_path;
+            }
+            cerr << endl;
+
+            running_server = &network_server;
+            signal(SIGINT, HandleStopSignal);
+            signal(SIGTERM, HandleStopSignal);
+            network_server.Run();
+            running_server = nullptr;
+
+            const NetworkServerStats stats = network_server.GetStats();
+            cerr << stats.connections << " connections, "s << stats.requests << " requests in "s << stats.batches
+                 << " batches (average "s << stats.GetAverageBatchSize() << ", max "s << stats.max_batch_size << "), "s
+                 << stats.backpressure_pauses << " backpressure pauses"s << endl;
+        }
+        if (!wal_directory.empty()) {
+            // следующий запуск прочитает снимок, а не весь журнал
+            LOG_DURATION("checkpoint"sv);
+            search_server.Checkpoint();
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl << USAGE;
+        return 1;
+    }
+    return 0;
+}
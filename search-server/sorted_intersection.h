@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+
+// Экспоненциальный ("галопирующий") поиск первого элемента >= value в [first, last).
+// Выгоден, когда искомые значения идут по возрастанию и близко к началу диапазона.
+template <typename Iterator, typename Value>
+Iterator GallopingLowerBound(Iterator first, Iterator last, const Value& value) {
+    typename std::iterator_traits<Iterator>::difference_type step = 1;
+    Iterator low = first;
+    while (std::distance(low, last) > step && *std::next(low, step) < value) {
+        low = std::next(low, step);
+        step *= 2;
+    }
+    Iterator high = std::distance(low, last) > step ? std::next(low, step + 1) : last;
+    return std::lower_bound(low, high, value);
+}
+
+// Вызывает callback для каждого элемента отсортированного диапазона needles,
+// который есть в отсортированном диапазоне haystack. Каждый needle ищется галопом
+// от позиции предыдущего совпадения, поэтому короткий needles почти не зависит
+// от длины haystack.
+template <typename NeedleIterator, typename HaystackIterator, typename Callback>
+void IntersectSorted(NeedleIterator needles_first, NeedleIterator needles_last,
+                     HaystackIterator haystack_first, HaystackIterator haystack_last, Callback callback) {
+    for (; needles_first != needles_last && haystack_first != haystack_last; ++needles_first) {
+        haystack_first = GallopingLowerBound(haystack_first, haystack_last, *needles_first);
+        if (haystack_first != haystack_last && !(*needles_first < *haystack_first)) {
+            callback(*needles_first);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#include "standing_query_index.h"
+
+#include <algorithm>
+
+using namespace std;
+
+int StandingQueryIndex::Add(StandingQuery query, const vector<string>& trigger_words) {
+    int query_id;
+    if (!free_ids_.empty()) {
+        query_id = free_ids_.back();
+        free_ids_.pop_back();
+    } else {
+        query_id = static_cast<int>(queries_.size());
+        queries_.emplace_back();
+    }
+    const size_t status = static_cast<size_t>(query.status);
+    for (const string& word : trigger_words) {
+        triggers_[word][status].push_back(query_id);
+    }
+    queries_[query_id] = {move(query), trigger_words, true};
+    ++query_count_;
+    return query_id;
+}
+
+vector<string> StandingQueryIndex::Remove(int query_id) {
+    if (query_id < 0 || static_cast<size_t>(query_id) >= queries_.size() || !queries_[query_id].is_active) {
+        return {};
+    }
+    Entry& entry = queries_[query_id];
+    const size_t status = static_cast<size_t>(entry.query.status);
+    vector<string> unused_words;
+    for (string& word : entry.trigger_words) {
+        const auto it = triggers_.find(word);
+        // порядок запросов в списке не важен: удалённый замещается последним
+        vector<int>& query_ids = it->second[status];
+        *find(query_ids.begin(), query_ids.end(), query_id) = query_ids.back();
+        query_ids.pop_back();
+        if (all_of(it->second.begin(), it->second.end(), [](const vector<int>& ids) { return ids.empty(); })) {
+            triggers_.erase(it);
+            unused_words.push_back(move(word));
+        }
+    }
+    entry = Entry{};
+    free_ids_.push_back(query_id);
+    --query_count_;
+    return unused_words;
+}
+
+const StandingQuery* StandingQueryIndex::Find(int query_id) const {
+    if (query_id < 0 || static_cast<size_t>(query_id) >= queries_.size() || !queries_[query_id].is_active) {
+        return nullptr;
+    }
+    return &queries_[query_id].query;
+}
+
+const StandingQueryTriggers* StandingQueryIndex::FindTriggers(string_view word) const {
+    const auto it = triggers_.find(word);
+    return it != triggers_.end() ? &it->second : nullptr;
+}
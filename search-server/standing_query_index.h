@@ -0,0 +1,70 @@
+#pragma once
+
+#include "document.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Совпадение постоянного запроса с добавленным документом. relevance - та, с которой
+// FindTopDocuments вернул бы документ по этому запросу сразу после добавления.
+struct StandingQueryMatch {
+    int query_id;
+    int document_id;
+    double relevance;
+};
+
+using StandingQueryHandler = std::function<void(const StandingQueryMatch&)>;
+
+// Запрос, разобранный при регистрации; слова отсортированы и без повторов, слова фраз
+// входят и в plus_words
+struct StandingQuery {
+    DocumentStatus status;
+    std::vector<std::string> plus_words;
+    std::vector<std::string> minus_words;
+    std::vector<std::vector<std::string>> phrases;
+    // запрос - кандидат только по одному слову фразы, а не по каждому плюс-слову
+    bool has_single_trigger = false;
+};
+
+// Запросы, которые слово делает кандидатами, отдельно для документов каждого статуса
+using StandingQueryTriggers = std::array<std::vector<int>, 4>;
+
+// Обратный индекс постоянных запросов: слово -> запросы, для которых оно триггер.
+// Id освобождённых запросов переиспользуются, поэтому по id можно индексировать массивы
+// размера GetQueryIdLimit.
+class StandingQueryIndex {
+public:
+    // Документ становится кандидатом для запроса, если в нём есть любое из trigger_words
+    int Add(StandingQuery query, const std::vector<std::string>& trigger_words);
+    // Возвращает слова, которые больше не триггеры ни одного запроса; неизвестный id игнорируется
+    std::vector<std::string> Remove(int query_id);
+
+    // nullptr - запроса с таким id нет
+    const StandingQuery* Find(int query_id) const;
+    // nullptr - слово не триггер ни одного запроса. Указатель действителен, пока слово не
+    // вернётся из Remove.
+    const StandingQueryTriggers* FindTriggers(std::string_view word) const;
+
+    size_t GetQueryCount() const {
+        return query_count_;
+    }
+    size_t GetQueryIdLimit() const {
+        return queries_.size();
+    }
+
+private:
+    struct Entry {
+        StandingQuery query;
+        std::vector<std::string> trigger_words;
+        bool is_active = false;
+    };
+
+    std::vector<Entry> queries_;
+    std::vector<int> free_ids_;
+    size_t query_count_ = 0;
+    std::map<std::string, StandingQueryTriggers, std::less<>> triggers_;
+};
@@ -0,0 +1,15 @@
+#include "stop_word_set.h"
+
+using namespace std;
+
+StopWordSet::StopWordSet(const set<string, less<>>& word_set)
+    : displacements_(word_set.size()) {
+    const vector<string_view> words(word_set.begin(), word_set.end());
+    vector<uint32_t> slots(words.size());
+    vector<uint32_t> buckets(words.size());
+    bucket_seed_ = perfect_hash::Build(words, words.size(), displacements_, slots, buckets);
+    words_.reserve(words.size());
+    for (const uint32_t word_index : slots) {
+        words_.emplace_back(words[word_index]);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "word_hash.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Минимальная совершенная хеш-функция для неизменяемого набора слов (схема
+// "hash and displace"): слово попадает в корзину по HashWord(word, bucket_seed),
+// а его ячейка в таблице из n слов - HashWord(word, displacements[корзина]) % n.
+// Смещения подбираются при построении так, чтобы у каждого слова была своя ячейка,
+// поэтому проверка принадлежности - два хеша и одно сравнение строк.
+namespace perfect_hash {
+
+// больше слов в одной корзине не бывает, иначе берётся другой bucket_seed
+const size_t MAX_BUCKET_SIZE = 16;
+
+// Пытается разложить count слов по ячейкам; slots[i] - номер слова в ячейке i.
+// Вспомогательный массив buckets хранит корзину каждого слова.
+template <typename Words, typename Indices>
+constexpr bool TryBuild(const Words& words, size_t count, uint64_t bucket_seed,
+                        Indices& displacements, Indices& slots, Indices& buckets) {
+    for (size_t i = 0; i < count; ++i) {
+        slots[i] = static_cast<uint32_t>(count);
+        displacements[i] = 0;
+        buckets[i] = static_cast<uint32_t>(HashWord(words[i], bucket_seed) % count);
+    }
+    // сначала самые большие корзины, пока свободных ячеек много
+    const uint32_t max_displacement = static_cast<uint32_t>(count * 16 + 1024);
+    for (size_t bucket_size = MAX_BUCKET_SIZE; bucket_size > 0; --bucket_size) {
+        for (size_t bucket = 0; bucket < count; ++bucket) {
+            size_t members[MAX_BUCKET_SIZE + 1] = {};
+            size_t member_count = 0;
+            for (size_t i = 0; i < count && member_count <= MAX_BUCKET_SIZE; ++i) {
+                if (buckets[i] == bucket) {
+                    members[member_count++] = i;
+                }
+            }
+            if (member_count > MAX_BUCKET_SIZE) {
+                return false;
+            }
+            if (member_count != bucket_size) {
+                continue;
+            }
+            uint32_t displacement = 1;
+            for (;; ++displacement) {
+                if (displacement > max_displacement) {
+                    return false;
+                }
+                size_t positions[MAX_BUCKET_SIZE] = {};
+                bool fits = true;
+                for (size_t k = 0; k < member_count && fits; ++k) {
+                    positions[k] = HashWord(words[members[k]], displacement) % count;
+                    fits = slots[positions[k]] == count;
+                    for (size_t j = 0; j < k && fits; ++j) {
+                        fits = positions[j] != positions[k];
+                    }
+                }
+                if (fits) {
+                    for (size_t k = 0; k < member_count; ++k) {
+                        slots[positions[k]] = static_cast<uint32_t>(members[k]);
+                    }
+                    break;
+                }
+            }
+            displacements[bucket] = displacement;
+        }
+    }
+    return true;
+}
+
+// Строит таблицу для count различных слов, возвращает использованный bucket_seed
+template <typename Words, typename Indices>
+constexpr uint64_t Build(const Words& words, size_t count, Indices& displacements, Indices& slots, Indices& buckets) {
+    uint64_t bucket_seed = 0;
+    while (count > 0 && !TryBuild(words, count, bucket_seed, displacements, slots, buckets)) {
+        ++bucket_seed;
+    }
+    return bucket_seed;
+}
+
+}  // namespace perfect_hash
+
+// Набор стоп-слов, известный на этапе компиляции: таблица строится constexpr
+template <size_t N>
+class StaticStopWordSet {
+public:
+    constexpr explicit StaticStopWordSet(const std::array<std::string_view, N>& words) {
+        for (size_t i = 0; i < N; ++i) {
+            if (words[i].empty()) {
+                throw std::invalid_argument("Stop word is empty");
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (words[j] == words[i]) {
+                    throw std::invalid_argument("Stop words must be unique");
+                }
+            }
+        }
+        std::array<uint32_t, N> slots = {};
+        std::array<uint32_t, N> buckets = {};
+        bucket_seed_ = perfect_hash::Build(words, N, displacements_, slots, buckets);
+        for (size_t i = 0; i < N; ++i) {
+            words_[i] = words[slots[i]];
+        }
+    }
+
+    constexpr bool Contains(std::string_view word) const {
+        if constexpr (N == 0) {
+            return false;
+        } else {
+            const size_t bucket = HashWord(word, bucket_seed_) % N;
+            return words_[HashWord(word, displacements_[bucket]) % N] == word;
+        }
+    }
+
+    constexpr const std::array<std::string_view, N>& GetWords() const {
+        return words_;
+    }
+
+    constexpr const std::array<uint32_t, N>& GetDisplacements() const {
+        return displacements_;
+    }
+
+    constexpr uint64_t GetBucketSeed() const {
+        return bucket_seed_;
+    }
+
+private:
+    // words_[i] - слово, попавшее в ячейку i
+    std::array<std::string_view, N> words_ = {};
+    std::array<uint32_t, N> displacements_ = {};
+    uint64_t bucket_seed_ = 0;
+};
+
+// constexpr auto STOP_WORDS = MakeStaticStopWordSet({"and"sv, "in"sv, "at"sv});
+template <size_t N>
+constexpr StaticStopWordSet<N> MakeStaticStopWordSet(const std::string_view (&words)[N]) {
+    std::array<std::string_view, N> word_array = {};
+    for (size_t i = 0; i < N; ++i) {
+        word_array[i] = words[i];
+    }
+    return StaticStopWordSet<N>(word_array);
+}
+
+// Набор стоп-слов, построенный во время выполнения по той же схеме
+class StopWordSet {
+public:
+    StopWordSet() = default;
+    explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+    // Таблица уже построена на этапе компиляции, слова только копируются
+    template <size_t N>
+    explicit StopWordSet(const StaticStopWordSet<N>& static_set)
+        : words_(static_set.GetWords().begin(), static_set.GetWords().end())
+        , displacements_(static_set.GetDisplacements().begin(), static_set.GetDisplacements().end())
+        , bucket_seed_(static_set.GetBucketSeed()) {
+    }
+
+    bool Contains(std::string_view word) const {
+        if (words_.empty()) {
+            return false;
+        }
+        const size_t bucket = HashWord(word, bucket_seed_) % words_.size();
+        return words_[HashWord(word, displacements_[bucket]) % words_.size()] == word;
+    }
+
+    auto begin() const {
+        return words_.begin();
+    }
+
+    auto end() const {
+        return words_.end();
+    }
+
+    size_t size() const {
+        return words_.size();
+    }
+
+private:
+    std::vector<std::string> words_;
+    std::vector<uint32_t> displacements_;
+    uint64_t bucket_seed_ = 0;
+};
@@ -0,0 +1,96 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+void WriteVarint(vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& in) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= static_cast<uint32_t>(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(*in++) << shift;
+    return value;
+}
+
+}  // namespace
+
+TermDictionary::TermDictionary(const map<string_view, int>& terms) {
+    term_ids_.reserve(terms.size());
+    string_view previous;
+    for (const auto& [term, term_id] : terms) {
+        size_t shared = 0;
+        if (term_ids_.size() % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        } else {
+            const size_t max_shared = min(previous.size(), term.size());
+            while (shared < max_shared && previous[shared] == term[shared]) {
+                ++shared;
+            }
+        }
+        WriteVarint(data_, static_cast<uint32_t>(shared));
+        WriteVarint(data_, static_cast<uint32_t>(term.size() - shared));
+        data_.insert(data_.end(), term.begin() + shared, term.end());
+        term_ids_.push_back(term_id);
+        previous = term;
+    }
+    data_.shrink_to_fit();
+}
+
+string_view TermDictionary::GetBlockFirstTerm(size_t block) const {
+    const uint8_t* in = data_.data() + block_offsets_[block];
+    ReadVarint(in);
+    const uint32_t length = ReadVarint(in);
+    return {reinterpret_cast<const char*>(in), length};
+}
+
+vector<int> TermDictionary::FindByPrefix(string_view prefix, size_t max_terms) const {
+    vector<int> result;
+    if (term_ids_.empty() || max_terms == 0) {
+        return result;
+    }
+    // последний блок, первое слово которого меньше префикса: подходящие слова начинаются в нём или позже
+    size_t low = 0;
+    size_t high = block_offsets_.size();
+    while (high - low > 1) {
+        const size_t middle = (low + high) / 2;
+        if (GetBlockFirstTerm(middle) < prefix) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    string term;
+    const uint8_t* in = data_.data() + block_offsets_[low];
+    const uint8_t* const end = data_.data() + data_.size();
+    for (size_t index = low * BLOCK_SIZE; in != end; ++index) {
+        const uint32_t shared = ReadVarint(in);
+        const uint32_t suffix_length = ReadVarint(in);
+        term.resize(shared);
+        term.append(reinterpret_cast<const char*>(in), suffix_length);
+        in += suffix_length;
+
+        if (term.compare(0, prefix.size(), prefix) == 0) {
+            result.push_back(term_ids_[index]);
+            if (result.size() == max_terms) {
+                break;
+            }
+        } else if (term > prefix) {
+            break;
+        }
+    }
+    return result;
+}
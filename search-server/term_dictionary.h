@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Неизменяемый отсортированный словарь с фронтальным сжатием: слова хранятся
+// блоками по BLOCK_SIZE, первое слово блока целиком, остальные - как длина общего
+// с предыдущим словом префикса и оставшийся суффикс. Позволяет быстро перечислить
+// все слова с заданным префиксом.
+class TermDictionary {
+public:
+    TermDictionary() = default;
+    // terms - слова с их идентификаторами, упорядоченные по возрастанию слов
+    explicit TermDictionary(const std::map<std::string_view, int>& terms);
+
+    // Идентификаторы не более max_terms слов, начинающихся с prefix, в порядке возрастания слов
+    std::vector<int> FindByPrefix(std::string_view prefix, size_t max_terms) const;
+
+private:
+    static const size_t BLOCK_SIZE = 16;
+
+    std::string_view GetBlockFirstTerm(size_t block) const;
+
+    // block_offsets_[b] - начало блока b в data_
+    std::vector<uint32_t> block_offsets_;
+    std::vector<uint8_t> data_;
+    // term_ids_[i] - идентификатор i-го по порядку слова
+    std::vector<int> term_ids_;
+};
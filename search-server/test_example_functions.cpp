@@ -1,4 +1,9 @@
 #include "test_example_functions.h"
+
+#include <csignal>
+#include <filesystem>
+#include <sys/resource.h>
+
 using namespace std;
 
 
@@ -61,3 +66,124 @@ void PrintMatchDocumentResult(int document_id, const vector<string_view>& words,
 
 
 }
+
+namespace {
+
+void Check(bool value, const string& hint) {
+    if (!value) {
+        throw logic_error("Test failed: "s + hint);
+    }
+}
+
+template <typename Function>
+bool Throws(Function function) {
+    try {
+        function();
+    } catch (const exception&) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+void TestPagesWithTiedRelevance() {
+    // у документов с одинаковыми словами релевантность равна, порядок решают рейтинг и id
+    for (const int variant : {0, 1, 2}) {
+        SearchServerOptions options;
+        options.impact_ordered_postings = variant == 1;
+        options.hot_terms = variant == 2 ? 1 : 0;
+        SearchServer search_server("and with"s, options);
+        for (int id = 0; id < 40; ++id) {
+            search_server.AddDocument(id, id % 2 == 0 ? "white cat"s : "cat white"s, DocumentStatus::ACTUAL, {id % 3});
+        }
+        for (int id = 40; id < 45; ++id) {
+            search_server.AddDocument(id, "curly cat cat tail"s, DocumentStatus::ACTUAL, {1});
+        }
+        const vector<Document> top = search_server.FindTopDocuments("cat"s);
+        vector<Document> paged;
+        for (SearchCursor cursor; !cursor.IsEnd();) {
+            SearchPage page = search_server.FindNextDocuments("cat"s, cursor, 3);
+            paged.insert(paged.end(), page.documents.begin(), page.documents.end());
+            cursor = page.next;
+        }
+        const string hint = " (variant "s + to_string(variant) + ")"s;
+        Check(paged.size() == 45, "every document is on some page"s + hint);
+        for (size_t i = 0; i + 1 < paged.size(); ++i) {
+            const Document& lhs = paged[i];
+            const Document& rhs = paged[i + 1];
+            const bool ordered = lhs.relevance - rhs.relevance >= EPS
+                                 || (abs(lhs.relevance - rhs.relevance) < EPS
+                                     && (lhs.rating > rhs.rating || (lhs.rating == rhs.rating && lhs.id < rhs.id)));
+            Check(ordered, "pages are ordered by relevance, rating and id"s + hint);
+        }
+        for (size_t i = 0; i < top.size(); ++i) {
+            Check(top[i].id == paged[i].id, "first page repeats FindTopDocuments"s + hint);
+        }
+    }
+}
+
+void TestQuotesWithoutPositionalIndex() {
+    // без позиционного индекса кавычки - часть слова, как до появления фраз
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "white cat and \"quoted\" hat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "curly dog"s, DocumentStatus::ACTUAL, {2});
+    Check(search_server.FindTopDocuments("\"cat"s).empty(), "unclosed quote is a word"s);
+    Check(search_server.FindTopDocuments("\"-dog cat\""s).empty(), "minus inside quotes is a word"s);
+    const auto quoted = search_server.FindTopDocuments("\"quoted\""s);
+    Check(quoted.size() == 1 && quoted[0].id == 1, "quoted document word is found"s);
+    const auto minus_in_quotes = search_server.FindTopDocuments("white curly \"-dog"s);
+    Check(minus_in_quotes.size() == 2, "quoted minus word does not exclude"s);
+    const auto [words, status] = search_server.MatchDocument("\"quoted\" \"cat"s, 1);
+    Check(words == vector<string_view>{"\"quoted\""sv}, "match keeps quotes in words"s);
+
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer positional_server("and with"s, options);
+    positional_server.AddDocument(1, "white cat and hat"s, DocumentStatus::ACTUAL, {1});
+    Check(Throws([&] { positional_server.FindTopDocuments("\"cat"s); }), "unclosed phrase is an error"s);
+    Check(Throws([&] { positional_server.FindTopDocuments("\"-dog cat\""s); }), "minus word inside phrase is an error"s);
+    Check(positional_server.FindTopDocuments("\"white cat\""s).size() == 1, "phrase is found"s);
+}
+
+void TestWriteAheadLogFailureKeepsIndex() {
+    const string directory = (filesystem::temp_directory_path() / "search_server_wal_failure"s).string();
+    filesystem::remove_all(directory);
+    SearchServer search_server("and with"s);
+    search_server.OpenWriteAheadLog(directory);
+    search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.SyncWriteAheadLog();
+
+    // запись журнала длиннее предела размера файла завершается ошибкой EFBIG
+    rlimit old_limit{};
+    getrlimit(RLIMIT_FSIZE, &old_limit);
+    const auto old_handler = signal(SIGXFSZ, SIG_IGN);
+    rlimit limit = old_limit;
+    limit.rlim_cur = filesystem::file_size(directory + "/log"s) + 1024;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    search_server.AddDocument(2, "curly dog "s + string(4096, 'x'), DocumentStatus::ACTUAL, {2});
+    const bool sync_failed = Throws([&] { search_server.SyncWriteAheadLog(); });
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    signal(SIGXFSZ, old_handler);
+    Check(sync_failed, "sync after a failed log write throws"s);
+
+    // изменения после ошибки журнала не видны поиску
+    Check(Throws([&] { search_server.AddDocument(3, "nasty pigeon"s, DocumentStatus::ACTUAL, {3}); }),
+          "add after a failed log write throws"s);
+    Check(search_server.GetDocumentCount() == 2, "failed add leaves the document count"s);
+    Check(search_server.FindTopDocuments("pigeon"s).empty(), "failed add is not searchable"s);
+    Check(Throws([&] { search_server.RemoveDocument(1); }), "remove after a failed log write throws"s);
+    Check(Throws([&] { search_server.RemoveDocuments({1, 2}); }), "batch remove after a failed log write throws"s);
+    Check(search_server.GetDocumentCount() == 2, "failed removes leave the document count"s);
+    Check(search_server.FindTopDocuments("cat"s).size() == 1, "failed removes leave documents searchable"s);
+    filesystem::remove_all(directory);
+}
+
+void RunTests() {
+    TestPagesWithTiedRelevance();
+    cout << "TestPagesWithTiedRelevance OK"s << endl;
+    TestQuotesWithoutPositionalIndex();
+    cout << "TestQuotesWithoutPositionalIndex OK"s << endl;
+    TestWriteAheadLogFailureKeepsIndex();
+    cout << "TestWriteAheadLogFailureKeepsIndex OK"s << endl;
+}
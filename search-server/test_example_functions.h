@@ -7,3 +7,9 @@ void FindTopDocuments(const SearchServer& search_server, const string& raw_query
 void MatchDocuments(const SearchServer& search_server, const string& query) ;
 void PrintDocument(const Document& document) ;
 void PrintMatchDocumentResult(int document_id, const vector<string_view> &words, DocumentStatus status);
+
+// Проверки поведения сервера; бросают logic_error при первом несовпадении
+void TestPagesWithTiedRelevance();
+void TestQuotesWithoutPositionalIndex();
+void TestWriteAheadLogFailureKeepsIndex();
+void RunTests();
@@ -0,0 +1,60 @@
+#include "top_document_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+bool HasHigherTermFreq(const TopDocumentEntry& lhs, const TopDocumentEntry& rhs) {
+    if (lhs.term_freq != rhs.term_freq) {
+        return lhs.term_freq > rhs.term_freq;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.document_id < rhs.document_id;
+}
+
+void TopDocumentList::Build(vector<TopDocumentEntry> entries) {
+    best_excluded_.reset();
+    if (entries.size() > capacity_) {
+        nth_element(entries.begin(), entries.begin() + capacity_, entries.end(), HasHigherTermFreq);
+        // после nth_element на позиции capacity_ стоит лучший из не вошедших
+        best_excluded_ = entries[capacity_];
+        entries.resize(capacity_);
+    }
+    sort(entries.begin(), entries.end(), HasHigherTermFreq);
+    entries_ = move(entries);
+    entries_.reserve(capacity_);
+}
+
+void TopDocumentList::Insert(const TopDocumentEntry& entry) {
+    // после удалений список короче capacity, но документ ниже границы всё равно в него не входит
+    if ((best_excluded_ && !HasHigherTermFreq(entry, *best_excluded_))
+            || (entries_.size() == capacity_ && (entries_.empty() || !HasHigherTermFreq(entry, entries_.back())))) {
+        Exclude(entry);
+        return;
+    }
+    entries_.insert(upper_bound(entries_.begin(), entries_.end(), entry, HasHigherTermFreq), entry);
+    if (entries_.size() > capacity_) {
+        Exclude(entries_.back());
+        entries_.pop_back();
+    }
+}
+
+bool TopDocumentList::Remove(int document_id) {
+    const auto it = find_if(entries_.begin(), entries_.end(), [document_id](const TopDocumentEntry& entry) {
+        return entry.document_id == document_id;
+    });
+    if (it == entries_.end()) {
+        // граница остаётся прежней: она может стать завышенной, но не заниженной
+        return false;
+    }
+    entries_.erase(it);
+    return true;
+}
+
+void TopDocumentList::Exclude(const TopDocumentEntry& entry) {
+    if (!best_excluded_ || HasHigherTermFreq(entry, *best_excluded_)) {
+        best_excluded_ = entry;
+    }
+}
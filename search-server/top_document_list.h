@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+struct TopDocumentEntry {
+    int document_id;
+    double term_freq;
+    int rating;
+};
+
+// По убыванию TF, затем рейтинга, затем по возрастанию id. Для запроса из одного слова
+// это порядок выдачи при любом IDF: релевантность - TF, умноженная на общий для всех
+// документов IDF, поэтому изменение IDF не переставляет документы.
+bool HasHigherTermFreq(const TopDocumentEntry& lhs, const TopDocumentEntry& rhs);
+
+// Первые capacity документов слова (одного статуса) в порядке HasHigherTermFreq и верхняя
+// граница для всех остальных: лучший из документов, не попавших в список. Добавление
+// поддерживает список точным, удаление документа из списка только укорачивает его.
+class TopDocumentList {
+public:
+    explicit TopDocumentList(size_t capacity = 0)
+        : capacity_(capacity) {
+    }
+
+    // entries - все документы слова этого статуса в любом порядке
+    void Build(std::vector<TopDocumentEntry> entries);
+    void Insert(const TopDocumentEntry& entry);
+    // Документ удаляется из индекса; false - его не было в списке
+    bool Remove(int document_id);
+
+    const std::vector<TopDocumentEntry>& GetEntries() const {
+        return entries_;
+    }
+    // Не хуже любого документа вне списка; пусто - в списке все документы
+    const std::optional<TopDocumentEntry>& GetBestExcluded() const {
+        return best_excluded_;
+    }
+    // После удалений в списке осталось меньше половины, хотя за его пределами есть документы
+    bool NeedsRebuild() const {
+        return best_excluded_.has_value() && entries_.size() * 2 < capacity_;
+    }
+
+private:
+    void Exclude(const TopDocumentEntry& entry);
+
+    size_t capacity_;
+    std::vector<TopDocumentEntry> entries_;
+    std::optional<TopDocumentEntry> best_excluded_;
+};
@@ -0,0 +1,537 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t LOG_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+// поля записи без текста занимают меньше
+const size_t MAX_LOG_RECORD_SIZE = MAX_LOG_TEXT_SIZE + 64;
+const size_t READ_CHUNK_SIZE = 8 << 20;
+const size_t CHECKPOINT_BUFFER_SIZE = 8 << 20;
+const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+[[noreturn]] void ThrowSystemError(const string& what) {
+    throw system_error(errno, generic_category(), what);
+}
+
+void WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("write"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+// после создания или переименования файла запись каталога тоже должна попасть на диск
+void SyncDirectory(const string& directory) {
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("open "s + directory);
+    }
+    const int result = fsync(fd);
+    close(fd);
+    if (result != 0) {
+        ThrowSystemError("fsync "s + directory);
+    }
+}
+
+// Таблицы для обработки по 8 байт за шаг (slicing-by-8)
+array<array<uint32_t, 256>, 8> MakeCrc32cTables() {
+    array<array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (CRC32C_POLYNOMIAL & (0 - (crc & 1)));
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); ++k) {
+        for (size_t i = 0; i < 256; ++i) {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+void AppendUint32(string& out, uint32_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void AppendUint64(string& out, uint64_t value) {
+    AppendUint32(out, static_cast<uint32_t>(value));
+    AppendUint32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void StoreUint32(string& out, size_t offset, uint32_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        out[offset + i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+uint32_t LoadUint32(string_view data) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value |= uint32_t{static_cast<uint8_t>(data[i])} << (8 * i);
+    }
+    return value;
+}
+
+void EncodeRecord(string& out, uint64_t lsn, LogRecordType type, int document_id, DocumentStatus status, int rating,
+                  string_view text) {
+    const size_t start = out.size();
+    out.append(LOG_RECORD_HEADER_SIZE, '\0');
+    AppendUint64(out, lsn);
+    out.push_back(static_cast<char>(type));
+    if (type == LogRecordType::ADD) {
+        AppendUint32(out, static_cast<uint32_t>(document_id));
+        out.push_back(static_cast<char>(status));
+        AppendUint32(out, static_cast<uint32_t>(rating));
+        AppendUint32(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    } else if (type == LogRecordType::REMOVE) {
+        AppendUint32(out, static_cast<uint32_t>(document_id));
+    }
+    const string_view body(out.data() + start + LOG_RECORD_HEADER_SIZE, out.size() - start - LOG_RECORD_HEADER_SIZE);
+    StoreUint32(out, start, static_cast<uint32_t>(body.size()));
+    StoreUint32(out, start + sizeof(uint32_t), ComputeCrc32c(body));
+}
+
+// Чтение тела записи; если байт не хватило, IsComplete вернёт false
+class RecordReader {
+public:
+    explicit RecordReader(string_view body)
+        : data_(body) {
+    }
+
+    uint8_t ReadUint8() {
+        const string_view bytes = Take(1);
+        return bytes.empty() ? 0 : static_cast<uint8_t>(bytes[0]);
+    }
+
+    uint32_t ReadUint32() {
+        const string_view bytes = Take(sizeof(uint32_t));
+        return bytes.empty() ? 0 : LoadUint32(bytes);
+    }
+
+    uint64_t ReadUint64() {
+        const uint64_t low = ReadUint32();
+        return low | uint64_t{ReadUint32()} << 32;
+    }
+
+    string_view ReadString() {
+        return Take(ReadUint32());
+    }
+
+    // все байты тела разобраны и их хватило
+    bool IsComplete() const {
+        return is_valid_ && data_.empty();
+    }
+
+private:
+    string_view Take(size_t size) {
+        if (!is_valid_ || data_.size() < size) {
+            is_valid_ = false;
+            return {};
+        }
+        const string_view bytes = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return bytes;
+    }
+
+    string_view data_;
+    bool is_valid_ = true;
+};
+
+// frame - запись вместе с заголовком; false - контрольная сумма или поля не сходятся
+bool DecodeRecord(string_view frame, LogRecord& record) {
+    const string_view body = frame.substr(LOG_RECORD_HEADER_SIZE);
+    if (ComputeCrc32c(body) != LoadUint32(frame.substr(sizeof(uint32_t)))) {
+        return false;
+    }
+    RecordReader reader(body);
+    record.lsn = reader.ReadUint64();
+    const uint8_t type = reader.ReadUint8();
+    record.type = static_cast<LogRecordType>(type);
+    if (record.type == LogRecordType::ADD) {
+        record.document_id = static_cast<int>(reader.ReadUint32());
+        const uint8_t status = reader.ReadUint8();
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            return false;
+        }
+        record.status = static_cast<DocumentStatus>(status);
+        record.rating = static_cast<int>(reader.ReadUint32());
+        record.text = reader.ReadString();
+    } else if (record.type == LogRecordType::REMOVE) {
+        record.document_id = static_cast<int>(reader.ReadUint32());
+    } else if (record.type != LogRecordType::CHECKPOINT) {
+        return false;
+    }
+    return reader.IsComplete();
+}
+
+struct LogFileContent {
+    size_t file_size = 0;
+    // длина начала файла, состоящего из целых корректных записей
+    size_t valid_size = 0;
+};
+
+// Читает файл кусками по READ_CHUNK_SIZE: границы записей в куске находятся по длинам,
+// контрольные суммы проверяются и записи декодируются параллельно, по batch_size записей.
+// Отсутствующий файл - пустой журнал.
+LogFileContent ReadLogFile(const string& path, size_t batch_size, const LogRecordBatchHandler& handler) {
+    LogFileContent content;
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return content;
+        }
+        ThrowSystemError("open "s + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        ThrowSystemError("fstat "s + path);
+    }
+    content.file_size = static_cast<size_t>(file_stat.st_size);
+
+    string buffer;
+    vector<string_view> frames;
+    vector<LogRecord> records;
+    vector<char> is_valid;
+    bool is_corrupted = false;
+    bool is_eof = false;
+    try {
+        while (!is_corrupted && !is_eof) {
+            const size_t old_size = buffer.size();
+            buffer.resize(old_size + READ_CHUNK_SIZE);
+            ssize_t read_size;
+            do {
+                read_size = read(fd, buffer.data() + old_size, READ_CHUNK_SIZE);
+            } while (read_size < 0 && errno == EINTR);
+            if (read_size < 0) {
+                ThrowSystemError("read "s + path);
+            }
+            buffer.resize(old_size + static_cast<size_t>(read_size));
+            is_eof = read_size == 0;
+
+            frames.clear();
+            size_t position = 0;
+            bool has_invalid_size = false;
+            while (buffer.size() - position >= LOG_RECORD_HEADER_SIZE) {
+                const size_t body_size = LoadUint32(string_view(buffer).substr(position));
+                if (body_size > MAX_LOG_RECORD_SIZE) {
+                    has_invalid_size = true;
+                    break;
+                }
+                if (buffer.size() - position < LOG_RECORD_HEADER_SIZE + body_size) {
+                    break;
+                }
+                frames.push_back(string_view(buffer).substr(position, LOG_RECORD_HEADER_SIZE + body_size));
+                position += LOG_RECORD_HEADER_SIZE + body_size;
+            }
+
+            for (size_t begin = 0; begin < frames.size() && !is_corrupted; begin += batch_size) {
+                const size_t end = min(frames.size(), begin + batch_size);
+                records.assign(end - begin, LogRecord{});
+                is_valid.assign(end - begin, false);
+                vector<size_t> indices(end - begin);
+                iota(indices.begin(), indices.end(), size_t{0});
+                for_each(execution::par, indices.begin(), indices.end(), [&](size_t i) {
+                    is_valid[i] = DecodeRecord(frames[begin + i], records[i]);
+                });
+                const size_t valid_count = find(is_valid.begin(), is_valid.end(), false) - is_valid.begin();
+                records.resize(valid_count);
+                for (size_t i = 0; i < valid_count; ++i) {
+                    content.valid_size += frames[begin + i].size();
+                }
+                is_corrupted = valid_count < end - begin;
+                if (!records.empty()) {
+                    handler(records);
+                }
+            }
+            is_corrupted = is_corrupted || has_invalid_size;
+            buffer.erase(0, position);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return content;
+}
+
+}  // namespace
+
+uint32_t ComputeCrc32c(string_view data) {
+    static const auto tables = MakeCrc32cTables();
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+    uint32_t crc = ~uint32_t{0};
+    for (; size >= 8; bytes += 8, size -= 8) {
+        const uint32_t low = crc ^ (bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t{bytes[3]} << 24);
+        const uint32_t high = bytes[4] | bytes[5] << 8 | bytes[6] << 16 | uint32_t{bytes[7]} << 24;
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+              ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+    for (; size > 0; ++bytes, --size) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *bytes) & 0xFF];
+    }
+    return ~crc;
+}
+
+CheckpointWriter::CheckpointWriter(int fd)
+    : fd_(fd) {
+}
+
+void CheckpointWriter::AddDocument(int document_id, DocumentStatus status, int rating, string_view text) {
+    EncodeRecord(buffer_, 0, LogRecordType::ADD, document_id, status, rating, text);
+    if (buffer_.size() >= CHECKPOINT_BUFFER_SIZE) {
+        Flush();
+    }
+}
+
+void CheckpointWriter::Flush() {
+    WriteAll(fd_, buffer_);
+    buffer_.clear();
+}
+
+WriteAheadLog::WriteAheadLog(string directory, const WriteAheadLogOptions& options, const LogRecordBatchHandler& handler)
+    : directory_(move(directory))
+    , options_(options) {
+    if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        ThrowSystemError("mkdir "s + directory_);
+    }
+    // недописанный снимок от прерванного Checkpoint
+    unlink((directory_ + "/checkpoint.tmp"s).c_str());
+
+    uint64_t checkpoint_lsn = 0;
+    bool has_checkpoint_record = false;
+    const LogFileContent checkpoint = ReadLogFile(directory_ + "/checkpoint"s, options_.replay_batch_size,
+                                                  [&](vector<LogRecord>& records) {
+        if (records.back().type == LogRecordType::CHECKPOINT) {
+            checkpoint_lsn = records.back().lsn;
+            has_checkpoint_record = true;
+            records.pop_back();
+        }
+        recovery_.checkpoint_records += records.size();
+        handler(records);
+    });
+    // снимок появляется переименованием уже записанного файла, так что оборванным он быть не может
+    if (checkpoint.file_size > 0 && (!has_checkpoint_record || checkpoint.valid_size != checkpoint.file_size)) {
+        throw runtime_error("Corrupted checkpoint in "s + directory_);
+    }
+
+    // записи не новее снимка остаются, если Checkpoint прервался до очистки журнала
+    uint64_t last_lsn = checkpoint_lsn;
+    const string log_path = directory_ + "/log"s;
+    const LogFileContent log = ReadLogFile(log_path, options_.replay_batch_size, [&](vector<LogRecord>& records) {
+        records.erase(remove_if(records.begin(), records.end(), [checkpoint_lsn](const LogRecord& record) {
+            return record.lsn <= checkpoint_lsn;
+        }), records.end());
+        if (records.empty()) {
+            return;
+        }
+        last_lsn = records.back().lsn;
+        recovery_.log_records += records.size();
+        handler(records);
+    });
+    recovery_.discarded_bytes = log.file_size - log.valid_size;
+
+    fd_ = open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError("open "s + log_path);
+    }
+    // новые записи должны идти сразу за последней целой
+    if (recovery_.discarded_bytes > 0 && ftruncate(fd_, static_cast<off_t>(log.valid_size)) != 0) {
+        close(fd_);
+        ThrowSystemError("ftruncate "s + log_path);
+    }
+    if (options_.sync_to_disk) {
+        try {
+            SyncDirectory(directory_);
+        } catch (...) {
+            close(fd_);
+            throw;
+        }
+    }
+    next_lsn_ = last_lsn + 1;
+    durable_lsn_ = last_lsn;
+    flusher_ = thread(&WriteAheadLog::FlushLoop, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_records_.notify_one();
+    flusher_.join();
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAdd(int document_id, DocumentStatus status, int rating, string_view text) {
+    return Append(1, [&](string& out, uint64_t lsn) {
+        EncodeRecord(out, lsn, LogRecordType::ADD, document_id, status, rating, text);
+    });
+}
+
+uint64_t WriteAheadLog::AppendRemove(int document_id) {
+    return AppendRemoves({document_id});
+}
+
+uint64_t WriteAheadLog::AppendRemoves(const vector<int>& document_ids) {
+    return Append(document_ids.size(), [&](string& out, uint64_t lsn) {
+        for (const int document_id : document_ids) {
+            EncodeRecord(out, lsn++, LogRecordType::REMOVE, document_id, DocumentStatus::ACTUAL, 0, {});
+        }
+    });
+}
+
+uint64_t WriteAheadLog::Append(size_t record_count, const function<void(string& out, uint64_t first_lsn)>& encode) {
+    unique_lock lock(mutex_);
+    flushed_.wait(lock, [this] {
+        return error_ || buffer_.size() < options_.max_buffered_bytes;
+    });
+    ThrowIfFailed();
+    const size_t old_size = buffer_.size();
+    try {
+        encode(buffer_, next_lsn_);
+    } catch (...) {
+        // недописанные записи не должны попасть на диск
+        buffer_.resize(old_size);
+        throw;
+    }
+    next_lsn_ += record_count;
+    const uint64_t last_lsn = next_lsn_ - 1;
+    // фоновый поток будится, только когда ему есть что делать: на одном ядре каждое
+    // пробуждение - переключение контекста посреди добавления документов
+    const bool should_notify = old_size == 0 || (old_size < options_.commit_bytes && buffer_.size() >= options_.commit_bytes);
+    lock.unlock();
+    if (should_notify) {
+        has_records_.notify_one();
+    }
+    return last_lsn;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t lsn) {
+    unique_lock lock(mutex_);
+    if (durable_lsn_ < lsn && requested_lsn_ < lsn) {
+        requested_lsn_ = lsn;
+        has_records_.notify_one();
+    }
+    flushed_.wait(lock, [this, lsn] {
+        return error_ || durable_lsn_ >= lsn;
+    });
+    ThrowIfFailed();
+}
+
+void WriteAheadLog::Sync() {
+    WaitDurable(GetLastLsn());
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    lock_guard guard(mutex_);
+    return next_lsn_ - 1;
+}
+
+void WriteAheadLog::Checkpoint(const function<void(CheckpointWriter&)>& write_documents) {
+    // после Sync фоновый поток простаивает, пока этот поток не допишет что-нибудь сам
+    Sync();
+    const string temp_path = directory_ + "/checkpoint.tmp"s;
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowSystemError("open "s + temp_path);
+    }
+    try {
+        CheckpointWriter writer(fd);
+        write_documents(writer);
+        EncodeRecord(writer.buffer_, GetLastLsn(), LogRecordType::CHECKPOINT, 0, DocumentStatus::ACTUAL, 0, {});
+        writer.Flush();
+        if (options_.sync_to_disk && fdatasync(fd) != 0) {
+            ThrowSystemError("fdatasync "s + temp_path);
+        }
+    } catch (...) {
+        close(fd);
+        unlink(temp_path.c_str());
+        throw;
+    }
+    close(fd);
+    if (rename(temp_path.c_str(), (directory_ + "/checkpoint"s).c_str()) != 0) {
+        ThrowSystemError("rename "s + temp_path);
+    }
+    if (options_.sync_to_disk) {
+        SyncDirectory(directory_);
+    }
+    // всё из журнала теперь есть в снимке
+    if (ftruncate(fd_, 0) != 0 || (options_.sync_to_disk && fdatasync(fd_) != 0)) {
+        ThrowSystemError("ftruncate "s + directory_ + "/log"s);
+    }
+}
+
+void WriteAheadLog::FlushLoop() {
+    string batch;
+    while (true) {
+        uint64_t last_lsn;
+        {
+            unique_lock lock(mutex_);
+            has_records_.wait(lock, [this] {
+                return stopping_ || !buffer_.empty();
+            });
+            has_records_.wait_for(lock, options_.commit_interval, [this] {
+                return stopping_ || requested_lsn_ > durable_lsn_ || buffer_.size() >= options_.commit_bytes;
+            });
+            if (buffer_.empty()) {
+                return;
+            }
+            // всё, что дописано за время предыдущей записи, уходит одним write и одним fdatasync
+            batch.swap(buffer_);
+            last_lsn = next_lsn_ - 1;
+        }
+        flushed_.notify_all();
+        try {
+            WriteAll(fd_, batch);
+            if (options_.sync_to_disk && fdatasync(fd_) != 0) {
+                ThrowSystemError("fdatasync"s);
+            }
+        } catch (...) {
+            {
+                lock_guard guard(mutex_);
+                error_ = current_exception();
+            }
+            flushed_.notify_all();
+            return;
+        }
+        batch.clear();
+        {
+            lock_guard guard(mutex_);
+            durable_lsn_ = last_lsn;
+        }
+        flushed_.notify_all();
+    }
+}
+
+void WriteAheadLog::ThrowIfFailed() const {
+    if (error_) {
+        rethrow_exception(error_);
+    }
+}
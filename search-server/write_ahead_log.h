@@ -0,0 +1,142 @@
+#pragma once
+
+#include "document.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Журнал изменений сервера. Запись - длина тела (uint32), CRC-32C тела (uint32) и тело:
+// номер записи (uint64), тип (uint8) и поля типа; все числа little-endian. Запись,
+// которая не поместилась целиком или не сошлась с контрольной суммой, считается
+// оборванной при сбое: она и всё после неё отбрасываются.
+enum class LogRecordType : uint8_t {
+    // id документа (int32), статус (uint8), рейтинг (int32), текст (длина uint32 и байты)
+    ADD = 1,
+    // id документа
+    REMOVE = 2,
+    // последняя запись снимка: номер - последняя запись журнала, вошедшая в снимок
+    CHECKPOINT = 3,
+};
+
+struct LogRecord {
+    uint64_t lsn = 0;
+    LogRecordType type = LogRecordType::ADD;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+    std::string text;
+};
+
+// Вызывается при восстановлении с очередным пакетом записей в порядке журнала
+using LogRecordBatchHandler = std::function<void(std::vector<LogRecord>& records)>;
+
+// Документ длиннее не может быть записан в журнал
+const size_t MAX_LOG_TEXT_SIZE = 256 << 20;
+
+struct WriteAheadLogOptions {
+    // false - записи только передаются ОС без fdatasync: переживают падение процесса,
+    // но не отключение питания
+    bool sync_to_disk = true;
+    // Записи сбрасываются на диск, когда их накопится commit_bytes, когда от первой
+    // несброшенной записи пройдёт commit_interval или когда кто-то ждёт их в Sync
+    std::chrono::microseconds commit_interval{10'000};
+    size_t commit_bytes = 1 << 20;
+    // сколько байт записей может ждать сброса на диск, сверх этого Append ждёт
+    size_t max_buffered_bytes = 64 << 20;
+    // записей в пакете восстановления
+    size_t replay_batch_size = 4096;
+};
+
+struct WriteAheadLogRecovery {
+    size_t checkpoint_records = 0;
+    size_t log_records = 0;
+    // отброшенный оборванный или повреждённый хвост журнала
+    size_t discarded_bytes = 0;
+};
+
+class WriteAheadLog;
+
+// Пишет снимок во временный файл; снимок заменяет прежний только в WriteAheadLog::Checkpoint
+class CheckpointWriter {
+public:
+    void AddDocument(int document_id, DocumentStatus status, int rating, std::string_view text);
+
+private:
+    friend class WriteAheadLog;
+
+    explicit CheckpointWriter(int fd);
+    void Flush();
+
+    int fd_;
+    std::string buffer_;
+};
+
+// Журнал с групповой фиксацией: Append только кодирует запись в буфер, фоновый поток
+// забирает всё накопленное, пишет одним вызовом и делает один fdatasync на всех.
+// Без Sync запись оказывается на диске не позже чем через commit_interval и время сброса.
+// Каталог журнала содержит снимок (checkpoint) и журнал изменений после него (log).
+// Append, Checkpoint и Sync вызываются из одного потока, который изменяет сервер.
+class WriteAheadLog {
+public:
+    // Восстанавливает состояние: передаёт handler записи снимка, затем записи журнала новее
+    // снимка, обрезает оборванный хвост журнала и открывает его для дописывания.
+    // Ошибки файлов - system_error, повреждённый снимок - runtime_error.
+    WriteAheadLog(std::string directory, const WriteAheadLogOptions& options, const LogRecordBatchHandler& handler);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Возвращают номер последней добавленной записи; если фоновая запись завершилась
+    // ошибкой, бросают её, ничего не добавив
+    uint64_t AppendAdd(int document_id, DocumentStatus status, int rating, std::string_view text);
+    uint64_t AppendRemove(int document_id);
+    // Все записи пакета добавляются в буфер вместе или ни одна
+    uint64_t AppendRemoves(const std::vector<int>& document_ids);
+    // Ждёт, пока запись lsn и все до неё окажутся на диске
+    void WaitDurable(uint64_t lsn);
+    void Sync();
+    // Сбрасывает журнал, пишет снимок (write_documents добавляет в него все документы),
+    // атомарно заменяет им прежний и очищает журнал
+    void Checkpoint(const std::function<void(CheckpointWriter&)>& write_documents);
+
+    const WriteAheadLogRecovery& GetRecovery() const {
+        return recovery_;
+    }
+    uint64_t GetLastLsn() const;
+
+private:
+    // encode дописывает record_count записей с номерами от first_lsn
+    uint64_t Append(size_t record_count, const std::function<void(std::string& out, uint64_t first_lsn)>& encode);
+    void FlushLoop();
+    void ThrowIfFailed() const;
+
+    const std::string directory_;
+    const WriteAheadLogOptions options_;
+    WriteAheadLogRecovery recovery_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable has_records_;
+    std::condition_variable flushed_;
+    std::string buffer_;
+    uint64_t next_lsn_ = 1;
+    uint64_t durable_lsn_ = 0;
+    // номер записи, которую ждут в WaitDurable, 0 - никто не ждёт
+    uint64_t requested_lsn_ = 0;
+    std::exception_ptr error_;
+    bool stopping_ = false;
+    std::thread flusher_;
+};
+
+// CRC-32C (Castagnoli)
+uint32_t ComputeCrc32c(std::string_view data);